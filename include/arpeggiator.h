@@ -0,0 +1,76 @@
+#ifndef ARPEGGIATOR_H
+#define ARPEGGIATOR_H
+
+#include <stdint.h>
+
+// Order in which held notes are played
+enum ArpMode
+{
+    ARP_OFF,        // The sequence plays
+    ARP_UP,
+    ARP_DOWN,
+    ARP_UP_DOWN,    // Up then down, without repeating the top and bottom notes
+    ARP_AS_PLAYED,  // In the order the notes were pressed
+    ARP_RANDOM,
+    NUM_ARP_MODES
+};
+
+/*
+ * Arpeggiator over a held-note set, clocked by the player's steps
+ *
+ * Held notes are a 128 bit bitmap with a 16 bit mask of the non-empty bytes
+ * on top, so the next note up or down from any position is two bit scans no
+ * matter how many notes are held. Press order is kept in a small ring for
+ * ARP_AS_PLAYED and ARP_RANDOM. The octave range repeats the pattern up to
+ * 4 octaves higher. Nothing is sorted per step.
+ */
+class Arpeggiator
+{
+public:
+    static const uint8_t MAX_HELD = 12; // More held notes release the oldest
+    static const uint8_t MAX_OCTAVES = 4;
+
+private:
+    static const uint8_t HELD_BYTES = 16;
+
+    uint8_t held[HELD_BYTES]; // Bit n % 8 of byte n / 8 is set while note n is held
+    uint16_t heldBytes;       // Bit i is set while held[i] != 0
+    uint8_t order[MAX_HELD];  // Held notes in press order, oldest at orderStart
+    uint8_t orderStart;
+    uint8_t count;
+
+    ArpMode mode;
+    uint8_t octaves;
+    uint8_t octave;   // Octave of the last note played, 0 = as held
+    int lastNote;     // Held note last played, outside 0-127 to start over
+    int8_t orderIndex; // ARP_AS_PLAYED position in the ring
+    bool ascending;    // ARP_UP_DOWN direction
+
+    bool isHeld(uint8_t note);
+    int findUp(int from);   // Lowest held note >= from, -1 if none
+    int findDown(int from); // Highest held note <= from, -1 if none
+    bool stepUp();          // Moves to the next note up, false at the top of the top octave
+    bool stepDown();        // Moves to the next note down, false at the bottom of octave 0
+    void removeFromOrder(uint8_t note);
+    void restart();
+
+public:
+    Arpeggiator();
+
+    void setMode(ArpMode newMode);
+    ArpMode getMode();
+    void setOctaves(uint8_t range); // 1 to MAX_OCTAVES
+    uint8_t getOctaves();
+    bool isActive() { return mode != ARP_OFF; }
+
+    // Held-note input, from any note source
+    void noteOn(uint8_t note);
+    void noteOff(uint8_t note);
+    void releaseAll();
+    uint8_t getHeldCount() { return count; }
+
+    // Note for the next step, -1 while nothing is held
+    int nextNote();
+};
+
+#endif // ARPEGGIATOR_H
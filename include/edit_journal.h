@@ -0,0 +1,80 @@
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include <stdint.h>
+#include "sequence_limits.h"
+
+class Sequence;
+
+// Step value saved by the journal, or the length in note when step is JOURNAL_LENGTH_STEP
+struct JournalEntry
+{
+    uint8_t step; // Step index
+    uint8_t note;
+    uint16_t gate; // Gate duration in 1/32767, JOURNAL_GROUP_START on the first entry of an edit
+};
+
+const uint8_t JOURNAL_LENGTH_STEP = 0xFF;
+const uint16_t JOURNAL_GROUP_START = 0x8000;
+const uint16_t JOURNAL_GATE_MASK = 0x7FFF;
+
+static_assert(MAX_SEQUENCE_LENGTH <= JOURNAL_LENGTH_STEP, "Every step index must fit below JOURNAL_LENGTH_STEP");
+
+inline uint16_t packGate(float gate) { return (uint16_t)(gate * 32767.0f + 0.5f); }
+inline float unpackGate(uint16_t gate) { return (gate & JOURNAL_GATE_MASK) / 32767.0f; }
+
+// Edits with the same key in a row are merged into one undo step, EDIT_KEY_NONE never merges
+const uint16_t EDIT_KEY_NONE = 0;
+const uint16_t EDIT_KEY_NOTE = 0x100;      // | step, pitch pot sweeps and recording
+const uint16_t EDIT_KEY_GATE = 0x200;      // | step, timing pot sweeps
+const uint16_t EDIT_KEY_TRANSPOSE = 0x300; // Pitch pot transposing while playing
+
+/*
+ * Undo/redo journal for sequence edits
+ *
+ * A fixed ring of 4 byte entries, each holding the value a step had before an
+ * edit. Undoing swaps the entries of the newest edit with the sequence, so
+ * they then hold the values redo puts back; nothing else is stored. A bulk
+ * edit like randomize() saves every step it changes, which makes it a
+ * snapshot of the steps that differ. Recording is a constant time append,
+ * a full ring drops its oldest whole edit.
+ *
+ * The journal follows one sequence at a time: an edit of another sequence
+ * (a pattern loaded into the back buffer) starts it over for that one, while
+ * Sequence::copyFrom() hands it on to the copy.
+ */
+class EditJournal
+{
+public:
+    static const uint8_t SIZE = 48; // Entries, 3 randomized 16 step patterns
+
+private:
+    JournalEntry entries[SIZE];
+    uint8_t oldest;      // Ring index of the oldest entry
+    uint8_t undoCount;   // Entries from oldest that can be undone
+    uint8_t redoCount;   // Entries after those that can be redone
+    Sequence *owner;     // Sequence the entries belong to
+    uint16_t groupKey;   // Key of the edit entries go to, EDIT_KEY_NONE once closed
+    uint8_t groupSteps[MAX_SEQUENCE_LENGTH / 8 + 1]; // Steps already saved in that edit, the bit after the last step is the length
+    bool groupStart;     // The next entry starts a new edit
+    bool discarding;     // The edit outgrew the ring and can't be undone
+
+    JournalEntry &entryAt(uint8_t index) { return entries[(oldest + index) % SIZE]; }
+
+public:
+    EditJournal();
+    void clear();
+
+    // Called by Sequence before and during every edit
+    void beginEdit(Sequence *sequence, uint16_t key);
+    void record(uint8_t step, int note, float gate);
+    void transfer(const Sequence *from, Sequence *to) { owner = owner == from ? to : owner; } // History follows a copy
+    void forget(Sequence *sequence); // The sequence was overwritten by a load, its history no longer applies
+
+    bool canUndo(Sequence *sequence) { return sequence == owner && undoCount > 0; }
+    bool canRedo(Sequence *sequence) { return sequence == owner && redoCount > 0; }
+    void undo(Sequence *sequence); // Check canUndo() first
+    void redo(Sequence *sequence); // Check canRedo() first
+};
+
+#endif // EDIT_JOURNAL_H
@@ -0,0 +1,23 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <Arduino.h>
+#include "scales.h"
+
+/*
+ * Allocation-free text formatting for the UI
+ *
+ * Replaces sprintf/dtostrf, which are slow on AVR and pull in several
+ * kilobytes of printf code. Every function writes into a caller-provided
+ * buffer, null terminates it and returns a pointer to the terminator so
+ * calls can be chained. Name tables live in PROGMEM.
+ */
+
+char *formatUInt(char *buffer, unsigned int value);        // "123"
+char *formatInt(char *buffer, int value);                  // "-12"
+char *formatTenths(char *buffer, unsigned int tenths);     // 1205 -> "120.5"
+char *formatNoteName(char *buffer, int midiNote);          // 61 -> "C#4", needs 5 bytes
+char *formatScaleName(char *buffer, int scaleType);        // 2 -> "Harm Min", needs 9 bytes
+char *formatString_P(char *buffer, const char *progmemStr); // Copy a PSTR() string
+
+#endif // FORMAT_H
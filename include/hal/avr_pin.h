@@ -0,0 +1,88 @@
+#ifndef AVR_PIN_H
+#define AVR_PIN_H
+
+#include <avr/io.h>
+
+/*
+ * One GPIO pin of a classic AVR port, resolved at compile time
+ *
+ * PIN_ADDRESS is the I/O address of the PINx register, DDRx and PORTx follow
+ * it. All addresses are constants in the low I/O space, so high(), low() and
+ * read() compile to single sbi/cbi/sbic instructions, and toggle() to one out
+ * to PINx, instead of a digitalWrite() table walk.
+ */
+template <uint8_t PIN_ADDRESS, uint8_t BIT>
+struct AvrPin
+{
+    static const uint8_t MASK = 1 << BIT;
+
+    static volatile uint8_t &pinRegister() { return _SFR_IO8(PIN_ADDRESS); }
+    static volatile uint8_t &ddrRegister() { return _SFR_IO8(PIN_ADDRESS + 1); }
+    static volatile uint8_t &portRegister() { return _SFR_IO8(PIN_ADDRESS + 2); }
+
+    static void output() { ddrRegister() |= MASK; }
+    static void input()
+    {
+        ddrRegister() &= ~MASK;
+        portRegister() &= ~MASK;
+    }
+    static void inputPullup()
+    {
+        ddrRegister() &= ~MASK;
+        portRegister() |= MASK;
+    }
+    static void high() { portRegister() |= MASK; }
+    static void low() { portRegister() &= ~MASK; }
+    static void write(bool level)
+    {
+        if (level)
+            high();
+        else
+            low();
+    }
+    static void toggle() { pinRegister() = MASK; } // Writing 1 to PINx flips PORTx
+    static bool read() { return (pinRegister() & MASK) != 0; }
+};
+
+// I/O addresses of the PINx registers
+const uint8_t AVR_PINA = 0x00;
+const uint8_t AVR_PINB = 0x03;
+const uint8_t AVR_PINC = 0x06;
+const uint8_t AVR_PIND = 0x09;
+
+// Timer1 fast PWM on OC1A with ICR1 as TOP, shared by the classic AVR boards
+template <typename PinType>
+struct Timer1Pwm
+{
+    typedef PinType OutputPin;
+
+    static void begin()
+    {
+        OutputPin::output();
+        TCCR1A = 0;
+        TCCR1B = 0;
+        TCNT1 = 0;
+        TCCR1A = (1 << COM1A1) | (1 << WGM11);               // Non-inverting on OC1A, fast PWM part 1
+        TCCR1B = (1 << WGM13) | (1 << WGM12) | (1 << CS10); // Fast PWM part 2, no prescaler
+    }
+
+    static void setTop(uint16_t top)
+    {
+        uint8_t oldSREG = SREG;
+        cli();
+        ICR1 = top;
+        SREG = oldSREG;
+    }
+
+    static uint16_t getTop() { return ICR1; }
+
+    static void write(uint16_t compare)
+    {
+        uint8_t oldSREG = SREG;
+        cli(); // 16-bit registers share the TEMP byte with interrupt code
+        OCR1A = compare;
+        SREG = oldSREG;
+    }
+};
+
+#endif // AVR_PIN_H
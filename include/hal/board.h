@@ -0,0 +1,26 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+/*
+ * Compile-time board selection
+ *
+ * Board is a traits struct with the pin type (Board::Pin<N>), the panel
+ * wiring, the timer that produces the pitch CV and the TWI pins. Hardware
+ * classes take pins and timers as template parameters, so every access is
+ * resolved at compile time without virtual calls or pin lookup tables.
+ */
+
+#if !defined(__AVR__)
+#include "hal/board_host.h"
+typedef BoardHost Board;
+#elif defined(__AVR_ATmega328P__)
+#include "hal/board_uno.h"
+typedef BoardUno Board;
+#elif defined(__AVR_ATmega1284P__)
+#include "hal/board_mega1284.h"
+typedef BoardMega1284 Board;
+#else
+#error "No board traits for this MCU, add one in include/hal"
+#endif
+
+#endif // BOARD_H
@@ -0,0 +1,61 @@
+#ifndef BOARD_HOST_H
+#define BOARD_HOST_H
+
+#include <Arduino.h>
+
+// Implemented by the host build (src/host/sim_hardware.cpp)
+void hostSetPwmDutyCycle(uint8_t pin, float dutyCycle);
+
+// Host simulation: pins go through the Arduino shim so replays can observe them
+struct BoardHost
+{
+    static const unsigned long CPU_HZ = 16000000UL;
+
+    template <uint8_t N>
+    struct Pin
+    {
+        static void output() { pinMode(N, OUTPUT); }
+        static void input() { pinMode(N, INPUT); }
+        static void inputPullup() { pinMode(N, INPUT_PULLUP); }
+        static void high() { digitalWrite(N, HIGH); }
+        static void low() { digitalWrite(N, LOW); }
+        static void write(bool level) { digitalWrite(N, level ? HIGH : LOW); }
+        static void toggle() { digitalWrite(N, digitalRead(N) ? LOW : HIGH); }
+        static bool read() { return digitalRead(N) != LOW; }
+    };
+
+    // Same wiring as the Uno
+    static const uint8_t LEFT_LED_PIN = 12;
+    static const uint8_t RIGHT_LED_PIN = 13;
+    static const uint8_t PLAY_BUTTON_PIN = 2;
+    static const uint8_t LEFT_BUTTON_PIN = 7;
+    static const uint8_t RIGHT_BUTTON_PIN = 4;
+    static const uint8_t GATE_PIN = 8;
+    static const uint8_t TIMING_POT_CHANNEL = 3;
+    static const uint8_t PITCH_POT_CHANNEL = 2;
+    static const uint8_t MODULATION_POT_CHANNEL = 1;
+    static const uint8_t CV_IN_CHANNEL = 0;
+
+    typedef Pin<6> TriggerPin;
+
+    // Records the duty cycle instead of driving a timer
+    struct CvPwm
+    {
+        static const uint8_t PIN = 9;
+        typedef BoardHost::Pin<PIN> OutputPin;
+
+        static uint16_t top;
+
+        static void begin() { OutputPin::output(); }
+        static void setTop(uint16_t newTop) { top = newTop; }
+        static uint16_t getTop() { return top; }
+        static void write(uint16_t compare) { hostSetPwmDutyCycle(PIN, top > 0 ? (float)compare / top : 0.0f); }
+    };
+
+    typedef Pin<11> AudioPin;
+    typedef Pin<3> EnvelopePin;
+    typedef Pin<18> TwiSda;
+    typedef Pin<19> TwiScl;
+};
+
+#endif // BOARD_HOST_H
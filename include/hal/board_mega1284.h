@@ -0,0 +1,43 @@
+#ifndef BOARD_MEGA1284_H
+#define BOARD_MEGA1284_H
+
+#include "hal/avr_pin.h"
+
+// ATmega1284P at 20 MHz with the MightyCore standard pinout: 25% more clock and 16 KB of SRAM
+struct BoardMega1284
+{
+    static const unsigned long CPU_HZ = F_CPU;
+
+    // D0-D7 on PORTB, D8-D15 on PORTD, D16-D23 on PORTC, D24-D31 (A0-A7) on PORTA
+    template <uint8_t N>
+    struct Pin : AvrPin<(N < 8 ? AVR_PINB : N < 16 ? AVR_PIND : N < 24 ? AVR_PINC : AVR_PINA), N % 8>
+    {
+        static_assert(N < 32, "The ATmega1284P has pins 0-31");
+    };
+
+    // Panel wiring, PB5-PB7 stay free for the ISP header
+    static const uint8_t LEFT_LED_PIN = 0;
+    static const uint8_t RIGHT_LED_PIN = 1;
+    static const uint8_t PLAY_BUTTON_PIN = 2;
+    static const uint8_t LEFT_BUTTON_PIN = 3;
+    static const uint8_t RIGHT_BUTTON_PIN = 4;
+    static const uint8_t GATE_PIN = 12;
+    static const uint8_t TIMING_POT_CHANNEL = 3;
+    static const uint8_t PITCH_POT_CHANNEL = 2;
+    static const uint8_t MODULATION_POT_CHANNEL = 1;
+    static const uint8_t CV_IN_CHANNEL = 0; // PA0, 0-5V
+
+    // CV input trigger, PC6 (PCINT22). PD2/PD3 are RXD1/TXD1 for the sync link, and
+    // a trigger there would fire on every byte the link sends
+    static const uint8_t TRIGGER_PIN = 22;
+    static_assert(TRIGGER_PIN != 10 && TRIGGER_PIN != 11, "The CV trigger must not share the sync UART pins");
+    typedef Pin<TRIGGER_PIN> TriggerPin;
+
+    typedef Timer1Pwm<Pin<13> > CvPwm; // Pitch CV on OC1A (PD5)
+    typedef Pin<15> AudioPin;          // Audio voice on OC2A (PD7)
+    typedef Pin<14> EnvelopePin;       // Envelope on OC2B (PD6)
+    typedef Pin<17> TwiSda;            // PC1
+    typedef Pin<16> TwiScl;            // PC0
+};
+
+#endif // BOARD_MEGA1284_H
@@ -0,0 +1,39 @@
+#ifndef BOARD_UNO_H
+#define BOARD_UNO_H
+
+#include "hal/avr_pin.h"
+
+// Arduino Uno (ATmega328P, 16 MHz)
+struct BoardUno
+{
+    static const unsigned long CPU_HZ = F_CPU;
+
+    // Arduino pin numbers: D0-D7 on PORTD, D8-D13 on PORTB, A0-A5 (D14-D19) on PORTC
+    template <uint8_t N>
+    struct Pin : AvrPin<(N < 8 ? AVR_PIND : N < 14 ? AVR_PINB : AVR_PINC), (N < 8 ? N : N < 14 ? N - 8 : N - 14)>
+    {
+        static_assert(N < 20, "The Uno has pins 0-19");
+    };
+
+    // Panel wiring
+    static const uint8_t LEFT_LED_PIN = 12;
+    static const uint8_t RIGHT_LED_PIN = 13;
+    static const uint8_t PLAY_BUTTON_PIN = 2;
+    static const uint8_t LEFT_BUTTON_PIN = 7;
+    static const uint8_t RIGHT_BUTTON_PIN = 4;
+    static const uint8_t GATE_PIN = 8;
+    static const uint8_t TIMING_POT_CHANNEL = 3;
+    static const uint8_t PITCH_POT_CHANNEL = 2;
+    static const uint8_t MODULATION_POT_CHANNEL = 1;
+    static const uint8_t CV_IN_CHANNEL = 0; // A0, 0-5V
+
+    typedef Pin<6> TriggerPin; // CV input trigger, PD6 (PCINT22)
+
+    typedef Timer1Pwm<Pin<9> > CvPwm; // Pitch CV on OC1A
+    typedef Pin<11> AudioPin;         // Audio voice on OC2A
+    typedef Pin<3> EnvelopePin;       // Envelope on OC2B
+    typedef Pin<18> TwiSda;           // A4
+    typedef Pin<19> TwiScl;           // A5
+};
+
+#endif // BOARD_UNO_H
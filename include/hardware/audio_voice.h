@@ -0,0 +1,80 @@
+#ifndef AUDIO_VOICE_H
+#define AUDIO_VOICE_H
+
+#include <Arduino.h>
+#include "hal/board.h"
+#include "hardware/timer2.h"
+
+/*
+ * Audio voice: a wavetable DDS oscillator on the Timer2 PWM pin
+ *
+ * Enabled at compile time by adding -DENABLE_AUDIO_VOICE to build_flags in
+ * platformio.ini. When disabled every VOICE_* macro expands to nothing.
+ *
+ * The sample clock is the Timer2 tick (CPU_HZ / 510, 31.4 kHz on the Uno,
+ * see timer2.h) and the output is OC2A. Each sample adds a 24-bit phase increment and looks up the top 8 bits in a
+ * 256-entry PROGMEM table. The increment comes from a per-note table, so the
+ * interrupt does no math beyond the add. Filter the pin with an RC low-pass
+ * (e.g. 1k + 10nF) and AC couple it before an amplifier.
+ */
+
+enum AudioWaveform
+{
+    WAVE_SAW,
+    WAVE_SQUARE,
+    WAVE_TRIANGLE,
+    WAVE_SINE,
+    NUM_WAVEFORMS
+};
+
+constexpr float AUDIO_SAMPLE_RATE = TIMER2_TICK_RATE;
+
+#ifdef ENABLE_AUDIO_VOICE
+
+class AudioVoice
+{
+public:
+    static void begin();
+    static void setWaveform(AudioWaveform waveform);
+    static AudioWaveform getWaveform() { return waveform; }
+    static void noteOn(int midiNote); // Restarts the cycle at the midline
+    static void noteOff();            // Holds the output at the midline
+    static bool isSounding() { return sounding; }
+
+    // Called from the Timer2 interrupt only
+    static inline void handleInterrupt();
+
+private:
+    static AudioWaveform waveform;
+    static const uint8_t *wavetable; // Table used by the interrupt, silence is the sine at phase 0
+    static __uint24 phase;
+    static __uint24 increment;
+    static bool sounding;
+};
+
+// Kept inline so the interrupt only saves the few registers it uses: one 24-bit
+// add, one lpm and the compare register write, about 20 cycles plus entry/exit
+inline void AudioVoice::handleInterrupt()
+{
+    phase += increment;
+    OCR2A = pgm_read_byte(wavetable + (uint8_t)(phase >> 16));
+}
+
+#define VOICE_BEGIN() AudioVoice::begin()
+#define VOICE_NOTE_ON(note) AudioVoice::noteOn(note)
+#define VOICE_GATE(isHigh)                               \
+    do                                                   \
+    {                                                    \
+        if (!(isHigh) && AudioVoice::isSounding())       \
+            AudioVoice::noteOff();                       \
+    } while (0)
+
+#else
+
+#define VOICE_BEGIN()
+#define VOICE_NOTE_ON(note)
+#define VOICE_GATE(isHigh)
+
+#endif // ENABLE_AUDIO_VOICE
+
+#endif // AUDIO_VOICE_H
@@ -2,11 +2,16 @@
 #define BUTTON_H
 
 #include <Arduino.h>
+#include "hal/board.h"
+#include "input_trace.h"
 
+// Debounced button on a pin fixed at compile time, PIN is a Board pin number
+template <uint8_t PIN>
 class Button
 {
 private:
-    int pin;
+    typedef Board::Pin<PIN> InputPin;
+
     bool lastState;
     bool currentState;
     bool lastPressedState; // Track previous pressed state for wasPressed/wasReleased
@@ -14,11 +19,75 @@ private:
     float debounceDelay;   // Debounce delay in seconds
 
 public:
-    Button(int buttonPin, bool usePullup = true);
+    Button(bool usePullup = true);
     void update(float dt); // dt is delta time in seconds
     bool isPressed();
     bool wasPressed();
     bool wasReleased();
 };
 
+template <uint8_t PIN>
+Button<PIN>::Button(bool usePullup)
+    : lastState(HIGH), currentState(HIGH), lastPressedState(false), debounceTimer(0), debounceDelay(0.05f) // 50ms as seconds
+{
+    if (usePullup)
+    {
+        InputPin::inputPullup();
+    }
+    else
+    {
+        InputPin::input();
+    }
+}
+
+template <uint8_t PIN>
+void Button<PIN>::update(float dt)
+{
+    bool reading = InputPin::read();
+    TRACE_DIGITAL(PIN, reading);
+
+    if (reading != lastState)
+    {
+        debounceTimer = 0; // Reset timer when state changes
+    }
+    else
+    {
+        debounceTimer += dt; // Accumulate time when state is stable
+    }
+
+    if (debounceTimer > debounceDelay)
+    {
+        if (reading != currentState)
+        {
+            currentState = reading;
+        }
+    }
+
+    lastState = reading;
+}
+
+template <uint8_t PIN>
+bool Button<PIN>::isPressed()
+{
+    return currentState == LOW;
+}
+
+template <uint8_t PIN>
+bool Button<PIN>::wasPressed()
+{
+    bool pressed = isPressed();
+    bool result = pressed && !lastPressedState;
+    lastPressedState = pressed;
+    return result;
+}
+
+template <uint8_t PIN>
+bool Button<PIN>::wasReleased()
+{
+    bool pressed = isPressed();
+    bool result = !pressed && lastPressedState;
+    lastPressedState = pressed;
+    return result;
+}
+
 #endif // BUTTON_H
@@ -0,0 +1,62 @@
+#ifndef CV_INPUT_H
+#define CV_INPUT_H
+
+#include <Arduino.h>
+#include "hal/board.h"
+
+/*
+ * CV input: a quantizing sample-and-hold on Board::CV_IN_CHANNEL
+ *
+ * The input voltage (0-5V, 1V per octave) is converted to semitones above
+ * 0V with a PROGMEM table of ADC thresholds and then snapped to the selected
+ * scale. In CV_IN_STEP mode the player samples it at every step instead of
+ * playing the sequence note. In CV_IN_TRIGGER mode a rising edge on
+ * Board::TriggerPin samples it from the pin change interrupt and writes the
+ * pitch CV timer directly, so the unit works as a clocked quantizer. That
+ * takes about 50 us from the edge.
+ *
+ * Only the CV reading runs the ADC at CPU_HZ / 32 (500 kHz on the Uno, 26 us
+ * per conversion); it saves and restores ADMUX and ADCSRA, so the pots keep
+ * the Arduino clock and its full accuracy. Main loop readings go through
+ * guardedAnalogRead(), which holds the trigger interrupt off until their
+ * result is read, so the interrupt can never overwrite a pending result. An
+ * edge during a pot reading is handled right after it, up to about 160 us late.
+ */
+
+enum CvInputMode
+{
+    CV_IN_OFF,     // Sequence notes only
+    CV_IN_STEP,    // Sampled on every step
+    CV_IN_TRIGGER, // Sampled on the trigger input
+    NUM_CV_INPUT_MODES
+};
+
+class CvInput
+{
+public:
+    static const uint8_t SEMITONES = 60; // 5V range at 1V per octave, same as the pitch CV output
+
+    static void begin();
+    static void setMode(CvInputMode newMode);
+    static CvInputMode getMode() { return mode; }
+    static void setScale(int scaleType) { scale = scaleType; }
+
+    static uint8_t readSemitones();   // Unquantized, 0 to SEMITONES
+    static uint8_t sampleSemitones(); // Quantized to the scale, root at 0V
+
+    // analogRead() for the main loop, safe against the trigger interrupt
+    static int guardedAnalogRead(uint8_t pin);
+
+    // Called from the pin change interrupt only
+    static void handleTrigger();
+
+private:
+    static volatile CvInputMode mode;
+    static volatile uint8_t scale;
+    static bool triggerLevel;
+    static uint32_t compareStep; // Pitch CV compare value per semitone, 16.16 fixed point
+
+    static int readAdc();
+};
+
+#endif // CV_INPUT_H
@@ -3,24 +3,54 @@
 
 #include <Arduino.h>
 #include <U8g2lib.h>
-#include <Wire.h>
 
+// SSD1306 128x64 in page buffer mode, transferred by the interrupt driven Twi queue instead of Wire
+class U8G2_SSD1306_128X64_NONAME_1_TWI_ASYNC : public U8G2
+{
+public:
+    U8G2_SSD1306_128X64_NONAME_1_TWI_ASYNC(const u8g2_cb_t *rotation);
+};
+
+/*
+ * Frames are drawn one 8 pixel page at a time: beginFrame(), then for each
+ * page draw into the page buffer and call queuePage() until it returns false.
+ * A page is only started when canQueuePage() reports room for all of it in
+ * the TWI queue, so queueing never waits for the bus.
+ */
 class Display
 {
 private:
-    U8G2_SSD1306_128X64_NONAME_1_HW_I2C u8g2; // Use page buffer mode instead of full buffer
+    U8G2_SSD1306_128X64_NONAME_1_TWI_ASYNC u8g2; // Use page buffer mode instead of full buffer
     bool initialized;
+    bool frameActive;    // Pages of the frame are still to be drawn
+    bool powerOnPending; // Switch the panel on after the last page of the frame
 
 public:
     // Display constants
     static const int SCREEN_WIDTH = 128;
     static const int SCREEN_HEIGHT = 64;
 
+    // Queue bytes of one page: the data goes out in transfers of up to 24 bytes
+    // with a [length][address][control] header each (u8x8_cad_ssd13xx_fast_i2c),
+    // after 3 positioning commands and before a possible power-on command, 4 bytes each
+    static const uint8_t PAGE_QUEUE_BYTES = SCREEN_WIDTH + (SCREEN_WIDTH + 23) / 24 * 3 + 4 * 4;
+
     Display();
-    void setup(unsigned long i2cSpeed = 400000);
+
+    // Staged bring-up, none of these wait for the bus: begin() sends the
+    // controller init with the screen still off, the first full frame then
+    // replaces the 1 KB clear that U8g2::begin() would send, and powerOn()
+    // shows it once its last page is queued
+    void begin(unsigned long i2cSpeed = 400000);
+    void powerOn();
+
+    void beginFrame();
+    bool isFrameActive() { return frameActive; }
+    bool canQueuePage();
+    bool queuePage(); // Sends the page drawn, returns false after the last one
 
     // Direct access to U8g2 instance for drawing operations
-    U8G2_SSD1306_128X64_NONAME_1_HW_I2C &getU8g2() { return u8g2; }
+    U8G2 &getU8g2() { return u8g2; }
 
     bool isInitialized() const { return initialized; }
 };
@@ -0,0 +1,150 @@
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <Arduino.h>
+#include "hal/board.h"
+#include "hardware/timer2.h"
+
+/*
+ * Envelope generator on the Timer2 OC2B pin (Board::EnvelopePin)
+ *
+ * Enabled at compile time by adding -DENABLE_ENVELOPE to build_flags in
+ * platformio.ini. When disabled every ENVELOPE_* macro expands to nothing.
+ *
+ * Runs from the Timer2 tick (see timer2.h). Each segment moves a 16-bit
+ * phase by a fixed increment per tick and shapes it with a 256-entry
+ * exponential PROGMEM curve, like an RC charging, so the interrupt does one
+ * add, one lookup and one 8-bit scale, a few dozen cycles. Every step
+ * retriggers the attack from the current level. The segment times are
+ * fractions of the step's gate length, so the envelope follows
+ * Sequence::getGateDuration(), and in ADSR mode the interrupt starts the
+ * release itself when the gate time runs out. Filter the pin like the pitch
+ * CV (RC low-pass and buffer) to get a 0-5V envelope.
+ */
+
+enum EnvelopeMode
+{
+    ENVELOPE_ADSR, // Attack, decay to sustain while the gate is open, release after it
+    ENVELOPE_AD,   // Attack then decay to zero, ignores the gate length
+    NUM_ENVELOPE_MODES
+};
+
+#ifdef ENABLE_ENVELOPE
+
+class Envelope
+{
+public:
+    // Segment times are in 1/64 of the gate length, so 64 = the whole gate
+    static void begin();
+    static void setShape(EnvelopeMode newMode, uint8_t attack, uint8_t decay, uint8_t sustain, uint8_t release);
+    static void trigger(float gateSeconds); // Restarts the attack from the current level
+    static uint8_t getLevel() { return level; }
+
+    // Called from the Timer2 interrupt only
+    static inline void handleInterrupt();
+
+private:
+    enum Segment
+    {
+        SEGMENT_IDLE,
+        SEGMENT_ATTACK,
+        SEGMENT_DECAY,
+        SEGMENT_SUSTAIN,
+        SEGMENT_RELEASE
+    };
+
+    // Shape
+    static EnvelopeMode mode;
+    static uint8_t attackShare;
+    static uint8_t decayShare;
+    static uint8_t sustainLevel;
+    static uint8_t releaseShare;
+
+    // Interrupt state
+    static volatile uint8_t segment;
+    static volatile uint8_t level;
+    static uint8_t startLevel;
+    static uint8_t targetLevel;
+    static uint16_t phase;
+    static uint16_t increment;
+    static uint16_t decayIncrement;
+    static uint16_t releaseIncrement;
+    static __uint24 gateTicks; // Ticks until the gate closes, 0 once closed
+
+    static uint16_t segmentIncrement(uint32_t gate, uint8_t share);
+
+    // Inline like the handler: a call from the interrupt would make it save every scratch register
+    static inline void startSegment(uint8_t newSegment, uint8_t target, uint16_t newIncrement);
+    static inline void endSegment();
+};
+
+extern const uint8_t envelopeCurve[256] PROGMEM;
+
+inline void Envelope::startSegment(uint8_t newSegment, uint8_t target, uint16_t newIncrement)
+{
+    segment = newSegment;
+    startLevel = level;
+    targetLevel = target;
+    phase = 0;
+    increment = newIncrement;
+}
+
+inline void Envelope::endSegment()
+{
+    level = targetLevel;
+    OCR2B = targetLevel;
+    if (segment == SEGMENT_ATTACK)
+    {
+        startSegment(SEGMENT_DECAY, mode == ENVELOPE_AD ? 0 : sustainLevel, decayIncrement);
+    }
+    else if (segment == SEGMENT_DECAY && mode == ENVELOPE_ADSR)
+    {
+        segment = SEGMENT_SUSTAIN;
+    }
+    else
+    {
+        segment = SEGMENT_IDLE;
+    }
+}
+
+inline void Envelope::handleInterrupt()
+{
+    uint8_t current = segment;
+    if (current == SEGMENT_IDLE)
+    {
+        return;
+    }
+    if (gateTicks != 0 && --gateTicks == 0 && mode == ENVELOPE_ADSR)
+    {
+        startSegment(SEGMENT_RELEASE, 0, releaseIncrement);
+        return;
+    }
+    if (current == SEGMENT_SUSTAIN)
+    {
+        return;
+    }
+
+    uint16_t next = phase + increment;
+    if (next < phase)
+    {
+        endSegment();
+        return;
+    }
+    phase = next;
+    uint8_t shaped = pgm_read_byte(&envelopeCurve[phase >> 8]);
+    uint8_t newLevel = startLevel + (((int16_t)(targetLevel - startLevel) * shaped) >> 8);
+    level = newLevel;
+    OCR2B = newLevel;
+}
+
+#define ENVELOPE_BEGIN() Envelope::begin()
+#define ENVELOPE_TRIGGER(gateSeconds) Envelope::trigger(gateSeconds)
+
+#else
+
+#define ENVELOPE_BEGIN()
+#define ENVELOPE_TRIGGER(gateSeconds)
+
+#endif // ENABLE_ENVELOPE
+
+#endif // ENVELOPE_H
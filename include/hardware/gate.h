@@ -2,18 +2,22 @@
 #define GATE_H
 
 #include <Arduino.h>
+#include "hal/board.h"
 
+// Gate output on a pin fixed at compile time, PIN is a Board pin number
+template <uint8_t PIN>
 class Gate
 {
 private:
-    int pin;
+    typedef Board::Pin<PIN> OutputPin;
+
     bool isHigh;
     float gateStart;    // Time accumulated since gate started in seconds
     float gateDuration; // Duration of gate in seconds
     bool isGating;
 
 public:
-    Gate(int gatePin);
+    Gate();
     void high();
     void low();
     void trigger(float duration);
@@ -21,4 +25,52 @@ public:
     bool getState() const { return isHigh; }
 };
 
+template <uint8_t PIN>
+Gate<PIN>::Gate() : isHigh(false), gateStart(0), gateDuration(0), isGating(false)
+{
+    OutputPin::output();
+    OutputPin::low();
+}
+
+template <uint8_t PIN>
+void Gate<PIN>::high()
+{
+    isGating = false;
+    isHigh = true;
+    OutputPin::high();
+}
+
+template <uint8_t PIN>
+void Gate<PIN>::low()
+{
+    isGating = false;
+    isHigh = false;
+    OutputPin::low();
+}
+
+template <uint8_t PIN>
+void Gate<PIN>::trigger(float duration)
+{
+    isGating = true;
+    gateStart = 0;           // Start from 0 and count up
+    gateDuration = duration; // Duration in seconds
+    isHigh = true;
+    OutputPin::high();
+}
+
+template <uint8_t PIN>
+void Gate<PIN>::update(float dt)
+{
+    if (isGating)
+    {
+        gateStart += dt; // Accumulate time
+        if (gateStart >= gateDuration)
+        {
+            isHigh = false;
+            OutputPin::low();
+            isGating = false;
+        }
+    }
+}
+
 #endif // GATE_H
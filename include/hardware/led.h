@@ -2,21 +2,69 @@
 #define LED_H
 
 #include <Arduino.h>
+#include "hal/board.h"
 
+// LED on a pin fixed at compile time, PIN is a Board pin number
+template <uint8_t PIN>
 class LED
 {
 private:
-    int pin;
+    typedef Board::Pin<PIN> OutputPin;
+
     float blinkStart;    // Time accumulated since blink started in seconds
     float blinkDuration; // Duration of blink in seconds
     bool isBlinking;
 
 public:
-    LED(int ledPin);
+    LED();
     void on();
     void off();
     void blink(float duration);
     void update(float dt); // dt is delta time in seconds
 };
 
+template <uint8_t PIN>
+LED<PIN>::LED() : blinkStart(0), blinkDuration(0), isBlinking(false)
+{
+    OutputPin::output();
+    OutputPin::low();
+}
+
+template <uint8_t PIN>
+void LED<PIN>::on()
+{
+    isBlinking = false;
+    OutputPin::high();
+}
+
+template <uint8_t PIN>
+void LED<PIN>::off()
+{
+    isBlinking = false;
+    OutputPin::low();
+}
+
+template <uint8_t PIN>
+void LED<PIN>::blink(float duration)
+{
+    isBlinking = true;
+    blinkStart = 0;           // Start from 0 and count up
+    blinkDuration = duration; // Duration in seconds
+    OutputPin::high();
+}
+
+template <uint8_t PIN>
+void LED<PIN>::update(float dt)
+{
+    if (isBlinking)
+    {
+        blinkStart += dt; // Accumulate time
+        if (blinkStart >= blinkDuration)
+        {
+            OutputPin::low();
+            isBlinking = false;
+        }
+    }
+}
+
 #endif // LED_H
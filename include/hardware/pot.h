@@ -3,28 +3,52 @@
 
 #include <Arduino.h>
 
+// Response curves, stored as interpolated PROGMEM tables
+enum PotCurve
+{
+    POT_CURVE_LINEAR,
+    POT_CURVE_LOG, // Audio taper, x^2
+    POT_CURVE_EXP, // Exponential, (2^6x - 1) / 63
+    POT_CURVE_S,   // Smoothstep, 3x^2 - 2x^3
+    NUM_POT_CURVES
+};
+
+/*
+ * Readings go through an adaptive low-pass filter in 12.4 fixed point. The
+ * filter coefficient follows the smoothed speed of the input: at rest it sits
+ * at minAlpha/256 and hides ADC noise, on a fast turn it opens up to 1.0 so
+ * the value follows the knob without lag (a one-euro filter in integers).
+ */
 class Pot
 {
+public:
+    static const int MAX_VALUE = 1023;
+    static const uint8_t DEFAULT_MIN_ALPHA = 16;  // Filter coefficient at rest, out of 256
+    static const uint8_t DEFAULT_SPEED_GAIN = 8;  // How quickly the coefficient opens with speed
+
 private:
+    static const uint8_t FILTER_FRACTION_BITS = 4;
+
     int pin;
     int lastRawValue;
     int lastCheckedValue; // For hasChanged() tracking - instance variable, not static
-    float lastMappedValue;
     float time;         // Time accumulated since last read in seconds
     float readInterval; // Read interval in seconds
-    int smoothingWindow;
-    int *readings;
-    int readIndex;
-    int total;
-    bool useSmoothing;
+    int filteredValue;           // Reading in 1/16 LSB
+    unsigned int speed;          // Smoothed absolute change per read in 1/16 LSB
+    uint8_t minAlpha;
+    uint8_t speedGain;
+    bool primed;                 // False until the first reading seeds the filter
 
 public:
-    Pot(int analogPin, float intervalSeconds = 0.01f, int smoothingSamples = 3);
-    ~Pot();
+    Pot(int analogPin, float intervalSeconds = 0.01f, uint8_t restAlpha = DEFAULT_MIN_ALPHA,
+        uint8_t gain = DEFAULT_SPEED_GAIN);
     void update(float dt); // dt is delta time in seconds
     int getRawValue();
+    int getCurvedValue(PotCurve curve); // 0-1023
     float getLinearValue(float minValue = 0.0, float maxValue = 1.0);
-    float getLogValue(float minValue = 0.0, float maxValue = 1.0, float curve = 2.0);
+    float getLogValue(float minValue = 0.0, float maxValue = 1.0);
+    float getCurveValue(PotCurve curve, float minValue = 0.0, float maxValue = 1.0);
     bool hasChanged(int threshold = 5);
     void setReadInterval(float intervalSeconds);
 };
@@ -2,19 +2,96 @@
 #define PWM_H
 
 #include <Arduino.h>
+#include "hal/board.h"
 
+// PWM output on a timer channel fixed at compile time, e.g. PWM<Board::CvPwm>
+template <typename Channel>
 class PWM
 {
 private:
-    int pin;
     float maxVoltage;
     bool initialized;
 
 public:
-    PWM(int pwmPin, float maxVoltage = 5.0);
+    PWM(float maxVoltage = 5.0);
     void setup(float freq_hz = 20000.0);
     void setDutyCycle(float duty_cycle);
+    void setRatio(unsigned int numerator, unsigned int denominator); // Integer duty cycle, no float math
     void setVoltage(float voltage);
 };
 
-#endif // PWM_H
\ No newline at end of file
+template <typename Channel>
+PWM<Channel>::PWM(float maxVoltage) : maxVoltage(maxVoltage), initialized(false)
+{
+}
+
+/**
+ * @brief Setup PWM on the channel's pin with the given frequency
+ * @param freq_hz Frequency in Hz for the PWM signal (default: 20kHz)
+ *
+ * This function initializes the timer if not already done and sets the
+ * period from the board's CPU clock.
+ */
+template <typename Channel>
+void PWM<Channel>::setup(float freq_hz)
+{
+    if (!initialized)
+    {
+        Channel::begin();
+        initialized = true;
+    }
+
+    // CPU clock / freq_hz = timer top value
+    // Subtract 1 from result because counter goes from 0 to TOP
+    unsigned long calculated_top_long = (Board::CPU_HZ / freq_hz) - 1;
+    unsigned int top;
+    if (calculated_top_long > 65535)
+    {
+        top = 65535; // Frequency too low for a 16-bit timer at this clock
+    }
+    else if (calculated_top_long < 1)
+    {
+        top = 1; // Frequency too high, no useful resolution left
+    }
+    else
+    {
+        top = static_cast<unsigned int>(calculated_top_long);
+    }
+    Channel::setTop(top);
+}
+
+template <typename Channel>
+void PWM<Channel>::setDutyCycle(float duty_cycle)
+{
+    if (!initialized)
+        return;
+
+    // Calculate the compare value based on normalized duty cycle (0.0 - 1.0)
+    Channel::write(static_cast<unsigned int>(Channel::getTop() * duty_cycle));
+}
+
+template <typename Channel>
+void PWM<Channel>::setRatio(unsigned int numerator, unsigned int denominator)
+{
+    if (!initialized || denominator == 0)
+        return;
+
+    if (numerator > denominator)
+        numerator = denominator;
+    Channel::write((unsigned int)((unsigned long)Channel::getTop() * numerator / denominator));
+}
+
+template <typename Channel>
+void PWM<Channel>::setVoltage(float voltage)
+{
+    if (!initialized)
+        return;
+
+    // Clamp voltage to the range [0, maxVoltage]
+    float clampedVoltage = constrain(voltage, 0.0f, maxVoltage);
+
+    // Set the normalized duty cycle (0.0 - 1.0)
+    setDutyCycle(clampedVoltage / maxVoltage);
+}
+
+#endif // PWM_H
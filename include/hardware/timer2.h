@@ -0,0 +1,29 @@
+#ifndef TIMER2_H
+#define TIMER2_H
+
+#include <Arduino.h>
+#include "hal/board.h"
+
+/*
+ * Timer2 tick shared by the audio voice and the envelope generator
+ *
+ * Timer2 runs 8-bit phase correct PWM without a prescaler, so OC2A and OC2B
+ * are two PWM outputs and the overflow interrupt fires at CPU_HZ / 510
+ * (31.4 kHz on the Uno). The interrupt lives in timer2.cpp and calls the
+ * inline handler of every feature that is compiled in, so each one only pays
+ * for its own few dozen cycles.
+ */
+
+constexpr float TIMER2_TICK_RATE = Board::CPU_HZ / 510.0f;
+
+#if defined(ENABLE_AUDIO_VOICE) || defined(ENABLE_ENVELOPE)
+
+class Timer2
+{
+public:
+    static void begin(); // Starts the timer and its interrupt, safe to call more than once
+};
+
+#endif
+
+#endif // TIMER2_H
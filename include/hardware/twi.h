@@ -0,0 +1,57 @@
+#ifndef TWI_H
+#define TWI_H
+
+#include <Arduino.h>
+#include <U8x8lib.h>
+
+#ifndef TWI_TX_BUFFER_SIZE
+#define TWI_TX_BUFFER_SIZE 256 // Power of two up to 256, holds one display page with its headers (Display::PAGE_QUEUE_BYTES)
+#endif
+
+/*
+ * Interrupt driven, transmit-only TWI (I2C) master
+ *
+ * Transfers are copied into a ring buffer as [length][address][data...] and
+ * clocked out by the TWI interrupt, so the caller returns as soon as the bytes
+ * are queued. A full buffer makes the caller wait, so callers on the main loop
+ * check getFree() first and only queue what fits. Consecutive transfers are
+ * chained with repeated starts.
+ */
+class Twi
+{
+public:
+    static void begin(unsigned long clockHz);
+    static void setClock(unsigned long clockHz);
+
+    // Queue one transfer, the address is the 8 bit write address (7 bit address << 1)
+    static void beginTransmission(uint8_t address);
+    static void write(uint8_t data);
+    static void endTransmission();
+
+    static bool isBusy();
+    static uint8_t getFree(); // Bytes that can be queued without waiting, headers included
+    static void flush(); // Wait until everything queued has been sent
+
+    // Called from the TWI interrupt only
+    static void handleInterrupt();
+
+private:
+    static const uint8_t MASK = TWI_TX_BUFFER_SIZE - 1;
+
+    static uint8_t buffer[TWI_TX_BUFFER_SIZE];
+    static volatile uint8_t head;   // End of committed transfers, read by the ISR
+    static volatile uint8_t tail;   // Next byte the ISR sends
+    static uint8_t writeHead;       // End of the transfer being queued
+    static uint8_t lengthIndex;     // Slot of the length byte of the transfer being queued
+    static uint8_t pendingLength;   // Data bytes queued in the current transfer
+    static volatile uint8_t remaining; // Data bytes left in the transfer on the bus
+    static volatile bool busy;
+
+    static void put(uint8_t data);
+    static void startNext(); // ISR context: load the next transfer header and send START
+};
+
+// u8x8 byte callback that queues display transfers on Twi
+extern "C" uint8_t u8x8_byte_twi_async(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
+
+#endif // TWI_H
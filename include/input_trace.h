@@ -0,0 +1,83 @@
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Input trace recorder
+ *
+ * Enabled at compile time by adding -DENABLE_TRACE to build_flags in
+ * platformio.ini. When disabled every TRACE_* macro expands to nothing.
+ *
+ * Records everything update() reacts to: the loop time step and the button
+ * and pot readings, as a compact byte stream. Only readings that differ from
+ * the previous one are stored. The stream is sent as FRAME_TRACE frames once
+ * the CMD_TRACE protocol command starts a capture, and can be replayed on the
+ * host with seqreplay (src/host/seqreplay.cpp).
+ *
+ * Stream format, events after a frame record belong to that frame:
+ *   0x00 [dt LEB128]       loop frame, dt in microseconds
+ *   0x10 | pin             digital pin read LOW
+ *   0x20 | pin             digital pin read HIGH
+ *   0x30 | channel [lo][hi] analog channel reading
+ *   0xF0 [count]           events were dropped (ring buffer overflow)
+ */
+
+const uint8_t TRACE_FRAME = 0x00;
+const uint8_t TRACE_DIGITAL_LOW = 0x10;
+const uint8_t TRACE_DIGITAL_HIGH = 0x20;
+const uint8_t TRACE_ANALOG = 0x30;
+const uint8_t TRACE_OVERFLOW = 0xF0;
+const uint8_t TRACE_TYPE_MASK = 0xF0;
+
+const uint8_t TRACE_MAX_DIGITAL_PINS = 16;
+const uint8_t TRACE_MAX_ANALOG_CHANNELS = 8;
+
+#ifdef ENABLE_TRACE
+
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE 128 // Must be a power of two
+#endif
+
+class InputTrace
+{
+private:
+    static uint8_t buffer[TRACE_BUFFER_SIZE];
+    static uint8_t head;
+    static uint8_t tail;
+    static uint8_t dropped;
+    static bool active;
+    static uint16_t digitalState;                      // Last recorded level per pin
+    static uint16_t digitalKnown;                      // Pins recorded at least once
+    static int analogState[TRACE_MAX_ANALOG_CHANNELS]; // Last recorded reading, -1 = none
+
+    static uint8_t space();
+    static void put(uint8_t data);
+    static bool reserve(uint8_t size); // Records an overflow when the event does not fit
+
+public:
+    static void start(); // Clears the buffer, the next readings are all recorded
+    static void stop();
+    static bool isActive() { return active; }
+
+    static void frame(unsigned long dtMicros);
+    static void digital(uint8_t pin, uint8_t level);
+    static void analog(uint8_t channel, int value);
+
+    // Copy up to maxLength buffered bytes into output, returns the count
+    static uint8_t read(uint8_t *output, uint8_t maxLength);
+};
+
+#define TRACE_FRAME_MICROS(dtMicros) InputTrace::frame(dtMicros)
+#define TRACE_DIGITAL(pin, level) InputTrace::digital(pin, level)
+#define TRACE_ANALOG(channel, value) InputTrace::analog(channel, value)
+
+#else
+
+#define TRACE_FRAME_MICROS(dtMicros)
+#define TRACE_DIGITAL(pin, level)
+#define TRACE_ANALOG(channel, value)
+
+#endif // ENABLE_TRACE
+
+#endif // INPUT_TRACE_H
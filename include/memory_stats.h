@@ -0,0 +1,55 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <stdint.h>
+
+/*
+ * SRAM telemetry
+ *
+ * Enabled at compile time by adding -DENABLE_MEMORY_STATS to build_flags in
+ * platformio.ini. When disabled every MEMORY_* macro expands to nothing.
+ *
+ * The free RAM between the heap and the stack is painted with a canary byte
+ * before main() runs. The deepest stack use is found later by scanning for
+ * the first overwritten canary, and the heap break is sampled once per loop()
+ * for its high-water mark. The CMD_GET_MEMORY protocol command returns a
+ * MemoryReport. Static RAM per subsystem is listed at build time by
+ * tools/ram_map.py. AVR only, host builds report zeros.
+ */
+
+// All values in bytes
+struct MemoryReport
+{
+    uint16_t staticBytes;  // .data + .bss
+    uint16_t heapBytes;    // Heap in use now
+    uint16_t heapPeak;     // Largest heap seen
+    uint16_t stackPeak;    // Deepest stack since boot
+    uint16_t freeBytes;    // Between the heap and the stack pointer now
+    uint16_t minFreeBytes; // Never touched since boot, the real headroom
+};
+
+#ifdef ENABLE_MEMORY_STATS
+
+class MemoryStats
+{
+private:
+    static uint8_t *heapPeakTop;
+
+    static uint8_t *heapTop();
+
+public:
+    static const uint8_t STACK_CANARY = 0xC5;
+
+    static void update(); // Samples the heap break
+    static void read(MemoryReport &report); // Scans the painted area, about 0.3 ms per KB free
+};
+
+#define MEMORY_UPDATE() MemoryStats::update()
+
+#else
+
+#define MEMORY_UPDATE()
+
+#endif // ENABLE_MEMORY_STATS
+
+#endif // MEMORY_STATS_H
@@ -0,0 +1,65 @@
+#ifndef PATTERN_STORE_H
+#define PATTERN_STORE_H
+
+#include <stdint.h>
+#include "sequence.h"
+
+/*
+ * Pattern bank in EEPROM
+ *
+ * Each slot holds [length][note, gate]*maxSteps with gates packed as 0-255.
+ * An erased slot reads a length of 0xFF and is treated as empty. Loads and
+ * saves run as background jobs advanced by update() from loop(), so neither
+ * an EEPROM read burst nor the 3.3 ms per byte write time stalls playback.
+ * A load is not an edit: the target's undo journal is detached while it runs
+ * and drops the target's history when it completes.
+ *
+ * The last EEPROM byte is not part of any slot, it remembers the slot last
+ * saved or cued so the boot can bring that pattern back.
+ */
+class PatternStore
+{
+private:
+    static const int LOAD_STEPS_PER_UPDATE = 4; // Steps copied per update() call while loading
+
+    enum Job
+    {
+        JOB_IDLE,
+        JOB_LOAD,
+        JOB_SAVE
+    };
+
+    int maxSteps;
+    int slotSize;
+    Job job;
+    Sequence *jobSequence;
+    EditJournal *jobJournal; // Journal of the load target, reattached when the load completes
+    uint16_t jobAddress; // First EEPROM address of the slot being worked on
+    int jobOffset;  // Next byte (save) or step (load) to process
+    int jobLength;
+    uint8_t lastSlot;   // Slot to remember once the EEPROM is free
+    bool lastSlotDirty; // lastSlot has not been written yet
+
+    bool beginJob(Job newJob, int slot, Sequence *seq);
+
+public:
+    PatternStore(int maxPatternLength);
+
+    int getSlotCount();
+    bool isSlotUsed(int slot);
+
+    // Background jobs, only one can run at a time
+    bool beginLoad(int slot, Sequence *target);
+    bool beginSave(int slot, Sequence *source);
+    bool isBusy();
+    bool update(); // Advances the current job, returns true when it has just finished
+
+    // Slot last saved or cued, -1 if none. Set by beginSave(), written by update()
+    int getLastSlot();
+    void setLastSlot(int slot);
+
+    // Blocking load, for use before playback starts
+    bool load(int slot, Sequence *target);
+};
+
+#endif // PATTERN_STORE_H
@@ -0,0 +1,99 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/*
+ * Loop-time profiler
+ *
+ * Enabled at compile time by adding -DENABLE_PROFILER to build_flags in
+ * platformio.ini. When disabled every PROFILE_* macro expands to nothing and
+ * profiler.cpp compiles to an empty object, so release builds pay nothing.
+ *
+ * Usage:
+ *   PROFILE_SCOPE(PROFILE_DRAW_UI);    // times the enclosing scope
+ *   PROFILE_STEP_ONSET(periodMicros);  // call on every sequencer step
+ *
+ * The statistics are read with the CMD_PROFILE command of the serial protocol,
+ * which also resets them.
+ */
+
+#ifdef ENABLE_PROFILER
+
+#include <Arduino.h>
+
+// Named sections that can be timed
+enum ProfileSection
+{
+    PROFILE_LOOP,
+    PROFILE_DRAW_UI,
+    PROFILE_POT_UPDATE,
+    PROFILE_STEP_CALLBACK,
+    PROFILE_NUM_SECTIONS
+};
+
+// Statistics for one section, all values in microseconds
+struct ProfileStats
+{
+    static const int NUM_BUCKETS = 16; // Bucket i holds values in [2^(i-1), 2^i), last bucket is open-ended
+
+    unsigned long minValue;
+    unsigned long maxValue;
+    unsigned long sum;
+    unsigned long count;
+    uint16_t histogram[NUM_BUCKETS]; // Saturating counters
+
+    void reset();
+    void add(unsigned long value);
+};
+
+class Profiler
+{
+private:
+    static ProfileStats sections[PROFILE_NUM_SECTIONS];
+    static ProfileStats stepJitter; // Step interval error (actual - nominal period)
+    static long minDrift;           // Signed onset error relative to the ideal clock
+    static long maxDrift;
+    static unsigned long lastOnset;
+    static unsigned long idealOnset;
+    static bool clockRunning;
+    static unsigned int overheadNanos; // Measured cost of one empty PROFILE_SCOPE
+
+    static void printStats(Print &out, const __FlashStringHelper *name, const ProfileStats &stats);
+
+public:
+    static void begin(); // Measures the scope timer overhead
+    static void reset();
+
+    static void record(ProfileSection section, unsigned long micros);
+    static void stepOnset(unsigned long periodMicros);
+    static void restartClock(); // Call when playback (re)starts so the ideal clock is re-anchored
+
+    static void dump(Print &out);
+};
+
+// RAII timer that records the lifetime of the enclosing scope
+class ProfileScope
+{
+private:
+    ProfileSection section;
+    unsigned long start;
+
+public:
+    ProfileScope(ProfileSection profileSection) : section(profileSection), start(micros()) {}
+    ~ProfileScope() { Profiler::record(section, micros() - start); }
+};
+
+#define PROFILE_BEGIN() Profiler::begin()
+#define PROFILE_SCOPE(section) ProfileScope profileScope(section)
+#define PROFILE_STEP_ONSET(periodMicros) Profiler::stepOnset(periodMicros)
+#define PROFILE_RESTART_CLOCK() Profiler::restartClock()
+
+#else
+
+#define PROFILE_BEGIN()
+#define PROFILE_SCOPE(section)
+#define PROFILE_STEP_ONSET(periodMicros)
+#define PROFILE_RESTART_CLOCK()
+
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER_H
@@ -0,0 +1,60 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include "sequence.h"
+#include "sequence_player.h"
+
+// How recorded notes are written into the sequence
+enum RecordMode
+{
+    RECORD_OVERDUB, // Only the pitch of the nearest step is replaced, its gate is kept
+    RECORD_REPLACE  // Pitch and gate are replaced, the gate length follows how long the note was held
+};
+
+// Input event captured with the player position at the moment it happened
+struct RecordEvent
+{
+    uint8_t isNoteOn; // 1 for note on, 0 for note off
+    uint8_t note;     // MIDI note number
+    uint8_t step;     // Step that was playing when the event arrived
+    uint8_t phase;    // Position within that step (0-255)
+};
+
+class Recorder
+{
+private:
+    static const uint8_t QUEUE_SIZE = 8; // Must be a power of two
+
+    SequencePlayer *player; // Notes are written into the sequence the player is playing
+    RecordEvent queue[QUEUE_SIZE];
+    volatile uint8_t queueHead; // Next slot to write
+    volatile uint8_t queueTail; // Next slot to read
+    bool armed;
+    RecordMode mode;
+    int heldStep;      // Step the currently held note was quantized to, -1 if none
+    long heldPosition; // Unquantized position of the held note in 1/256 steps
+
+    bool enqueue(bool isNoteOn, int note);
+    void apply(const RecordEvent &event);
+
+public:
+    Recorder(SequencePlayer *seqPlayer);
+
+    // Record arming
+    void arm();
+    void disarm();
+    bool isArmed();
+
+    void setMode(RecordMode newMode);
+    RecordMode getMode();
+
+    // Input - only timestamps and queues the event, the sequence is written in process()
+    bool noteOn(int note);
+    bool noteOff(int note);
+
+    // Drain the event queue into the sequence, returns the number of steps written
+    int process();
+};
+
+#endif // RECORDER_H
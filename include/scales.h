@@ -0,0 +1,19 @@
+#ifndef SCALES_H
+#define SCALES_H
+
+#include <Arduino.h>
+
+/*
+ * Scales shared by randomize, the CV input quantizer and the UI
+ *
+ * Each scale is a 12 bit pitch class mask in PROGMEM: bit n is set when the
+ * note n semitones above the root belongs to the scale. The order matches
+ * the scale names in format.cpp.
+ */
+
+const int NUM_SCALES = 10;
+
+uint16_t getScaleMask(int scaleType); // Out of range types fall back to the nearest valid one
+int quantizeToScale(int note, int rootNote, int scaleType); // Nearest scale note, ties resolve downward
+
+#endif // SCALES_H
@@ -1,17 +1,44 @@
 #ifndef SEQUENCE_H
 #define SEQUENCE_H
 
+#include <stdint.h>
+#include "edit_journal.h"
+#include "sequence_limits.h"
+
+/*
+ * Change journal: every edit increments a 16 bit revision and stamps the
+ * steps it changed with it, so consumers can remember the revision they last
+ * saw and fetch only the steps changed since. Revisions are compared with
+ * wraparound, which stays exact as long as a consumer checks in at least
+ * every 32767 edits.
+ *
+ * With an EditJournal attached, every edit also saves the values it
+ * replaces, so it can be undone and redone.
+ */
 class Sequence
 {
 private:
-    int *notes;           // Array of MIDI note numbers
-    float *gateDurations; // Array of gate durations (0.0 to 1.0, as fraction of note duration)
-    int maxNotes;         // Maximum number of notes the sequence can hold
-    int currentNumNotes;  // Current number of notes in the sequence
+    int *notes;              // Array of MIDI note numbers
+    float *gateDurations;    // Array of gate durations (0.0 to 1.0, as fraction of note duration)
+    uint16_t *stepRevisions; // Revision of the last change per step
+    int maxNotes;            // Maximum number of notes the sequence can hold
+    int currentNumNotes;     // Current number of notes in the sequence
+    uint16_t revision;       // Incremented by every edit
+    uint16_t lengthRevision; // Revision of the last length change
+    EditJournal *journal;    // nullptr when edits can't be undone
+
+    void touch(int stepIndex) { stepRevisions[stepIndex] = revision; }
+    void setNumNotes(int length);
+    void beginEdit(uint16_t key = EDIT_KEY_NONE);
+    void saveStep(int stepIndex);
+    void swapEntry(JournalEntry &entry); // Exchanges the saved values with the current ones
+
+    friend class EditJournal;
+    static bool isNewer(uint16_t stamp, uint16_t since) { return (int16_t)(stamp - since) > 0; }
 
 public:
     // Constructor and destructor
-    Sequence(int maxSequenceLength);
+    Sequence(int maxSequenceLength); // Capped at MAX_SEQUENCE_LENGTH
     ~Sequence();
 
     // Basic sequence operations
@@ -24,11 +51,24 @@ public:
     void clear();
     void transpose(int semitones);
     void randomize(int rootNote = 36, int octaves = 3, int scaleType = 0); // Randomize notes from a scale
+    void copyFrom(const Sequence &source); // Exact copy including revisions and undo history, not an edit
 
     // Gate duration operations
     void setGateDuration(int stepIndex, float duration); // duration: 0.0 to 1.0
     float getGateDuration(int stepIndex);
     void setGateDurations(float *durations, int length);
+
+    // Change journal
+    uint16_t getRevision();
+    bool isStepChangedSince(int stepIndex, uint16_t sinceRevision);
+    uint32_t getChangedSteps(uint16_t sinceRevision, int firstStep = 0); // Bit i = step firstStep + i
+    bool isLengthChangedSince(uint16_t sinceRevision);
+
+    // Undo/redo, each call steps back or forward by one edit
+    void setJournal(EditJournal *editJournal);
+    EditJournal *getJournal();
+    bool undo();
+    bool redo();
 };
 
 #endif // SEQUENCE_H
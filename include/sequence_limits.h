@@ -0,0 +1,9 @@
+#ifndef SEQUENCE_LIMITS_H
+#define SEQUENCE_LIMITS_H
+
+// Longest pattern a Sequence can hold. Step indices and lengths travel as one
+// byte in the serial protocol, the EEPROM slots and StepEvent, and the edit
+// journal keeps a step index in 7 bits, so this is at most 128.
+const int MAX_SEQUENCE_LENGTH = 128;
+
+#endif // SEQUENCE_LIMITS_H
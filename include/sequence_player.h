@@ -1,20 +1,94 @@
 #ifndef SEQUENCE_PLAYER_H
 #define SEQUENCE_PLAYER_H
 
+#include <stdint.h>
 #include "sequence.h"
+#include "step_events.h"
 
-// Callback function type for step events
-typedef void (*StepCallback)(int currentStep, int currentNote, float noteDurationSeconds);
+// Step lengths, T = triplet
+enum StepResolution
+{
+    STEP_1_32,
+    STEP_1_16T,
+    STEP_1_16,
+    STEP_1_8T,
+    STEP_1_8,
+    STEP_1_4T,
+    STEP_1_4,
+    STEP_1_2T,
+    STEP_1_2,
+    STEP_1_BAR,
+    NUM_STEP_RESOLUTIONS
+};
+
+// Order in which the steps of a sequence are played
+enum PlaybackDirection
+{
+    PLAY_FORWARD,
+    PLAY_REVERSE,
+    PLAY_PENDULUM,    // Forward then back, without repeating the end steps
+    PLAY_RANDOM_WALK, // Each step moves one back, stays or moves one forward
+    PLAY_STRIDE,      // Every stride-th step, wrapping around the sequence
+    NUM_PLAYBACK_DIRECTIONS
+};
 
+/*
+ * All timing is derived from one master tick counter running at PPQN ticks per
+ * quarter note. The tick period is computed once per tempo change as a 24.8
+ * fixed-point number of microseconds, after that update() only adds, compares
+ * and subtracts integers.
+ */
 class SequencePlayer
 {
+public:
+    static const int PPQN = 96;                          // Master ticks per quarter note, divisible by 3 for triplets
+    static const uint8_t TICK_FRACTION_BITS = 8;         // Tick period is kept in 1/256 microseconds
+    static const unsigned long MIN_TICK_MICROS = 520;    // Shortest tick the main loop can service
+    static const unsigned long MAX_TICK_MICROS = 65535;  // Longest tick, keeps the period within 24 bits
+    static const unsigned long MAX_UPDATE_MICROS = 1000000UL; // Longer stalls are not caught up, steps within one are skipped silently
+
+    // Tempo limits that follow from the tick period range
+    static float getMinBpm() { return 60000000.0f / (PPQN * (float)MAX_TICK_MICROS); }
+    static float getMaxBpm() { return 60000000.0f / (PPQN * (float)MIN_TICK_MICROS); }
+
 private:
     Sequence *sequence;        // Pointer to the sequence being played
+    Sequence *queuedSequence;  // Sequence to switch to at the next bar boundary, nullptr if none
+    Sequence *stagedSequence;  // Edited copy to switch to at the next step, valid while editStaged is set
+    volatile bool editStaged;  // Written after stagedSequence, so one byte publishes the swap
+    unsigned int loopCount;    // Number of times playback wrapped back to the first step
     int currentStepIndex;      // Current step in the sequence
-    float time;                // Time accumulated since last step in seconds
+    int playPosition;          // Position in the playback order, mapped to currentStepIndex
     bool isPlaying;            // Whether the player is currently playing
     float bpm;                 // Current beats per minute
-    StepCallback stepCallback; // Callback function for step events
+
+    // Master clock
+    unsigned long masterTick;      // Ticks since start
+    unsigned long tickPeriod;      // Tick length in 1/256 microseconds
+    unsigned long tickAccumulator; // Time since the last tick in 1/256 microseconds
+    unsigned int ticksIntoStep;    // Ticks elapsed in the current step
+    unsigned int stepTicks;        // Step length in ticks
+
+    // Step length settings
+    StepResolution resolution;
+    uint8_t clockDivision;
+    uint8_t clockMultiplication;
+    uint8_t beatsPerBar; // Time signature numerator
+    uint8_t beatUnit;    // Time signature denominator
+
+    // Playback order, applied as an index mapping so the sequence itself is never touched
+    PlaybackDirection direction;
+    uint8_t stride;
+    uint8_t rotation;
+
+    void updateStepTicks();
+    void advanceStep();
+    void advancePosition(); // advanceStep() without publishing, for steps missed during a stall
+    void publishStep();
+    int getCycleLength(int length);            // Positions per pass through the sequence
+    int mapPosition(int position, int length); // Playback position to step index
+    void remapStoppedStep();                   // Shows the new first step when the order changes while stopped
+    void clampPosition();                      // Restarts a position past the end of a sequence that just went live
 
 public:
     // Constructor
@@ -25,28 +99,69 @@ public:
     void stop();
     void reset();
     bool getIsPlaying();
+    void retriggerStep(); // Reports the current step again, e.g. so the outputs show it at power-up
 
     // Update function - call this regularly to handle timing
-    void update(float dt); // dt is delta time in seconds
+    void update(float dt);                    // dt is delta time in seconds
+    void updateMicros(unsigned long dtMicros); // Same with an integer delta in microseconds
 
     // Step management
     int getCurrentStep();
     void setCurrentStep(int step);
 
     // Timing
-    void setBpm(float newBpm);
+    void setBpm(float newBpm); // Clamped to getMinBpm()..getMaxBpm()
     float getBpm();
+    void setTickPeriod(unsigned long period); // In 1/256 microseconds, for clock followers
+    unsigned long getTickPeriod();
     float getNoteDurationSeconds(); // Returns note duration in seconds
+    uint8_t getStepPhase();         // Position within the current step, 0-255
+
+    // Step resolution, integer clock division/multiplication and time signature
+    void setStepResolution(StepResolution newResolution);
+    StepResolution getStepResolution();
+    void setClockRatio(uint8_t division, uint8_t multiplication); // Step length * division / multiplication
+    void setTimeSignature(uint8_t beats, uint8_t unit);            // unit is 1, 2, 4, 8, 16 or 32
+    unsigned int getStepTicks();
+    unsigned int getTicksPerBar();
+    unsigned long getMasterTick();
+    bool isBarStart(); // True when the current step started on the first tick of a bar
+
+    // Clock position, for sync with other units (see include/sync_link.h)
+    unsigned long getTickAccumulator(); // Time into the current tick in 1/256 microseconds
+    unsigned int getTicksIntoStep();
+    int getPlayPosition();
+    // Jumps to another unit's position, an accumulator beyond one tick is caught up by the next update
+    void setSyncPosition(unsigned long tick, unsigned int intoStep, int position, unsigned long accumulator);
+
+    // Playback order, takes effect from the next step
+    void setDirection(PlaybackDirection newDirection);
+    PlaybackDirection getDirection();
+    void setStride(uint8_t newStride); // Step distance for PLAY_STRIDE, 1 or more
+    uint8_t getStride();
+    void setRotation(uint8_t steps); // Shifts the start of the sequence by this many steps
+    uint8_t getRotation();
 
     // Get current note
     int getCurrentNote();
 
-    // Callback management
-    void onStepAdvance(StepCallback callback);
-
     // Sequence management
-    void setSequence(Sequence *seq);
+    void setSequence(Sequence *seq);   // Switches immediately and resets to the first step
+    void queueSequence(Sequence *seq); // Switches when the current sequence wraps, without a gap
     Sequence *getSequence();
+    Sequence *getQueuedSequence();
+
+    /*
+     * Edited copies: a bulk edit goes into a copy of the playing sequence,
+     * which is switched in whole at the next step boundary (at once while
+     * stopped). Playback only ever reads the sequence pointer, so it never
+     * sees a half-applied edit and needs no locking.
+     */
+    void stageSequence(Sequence *seq);
+    bool withdrawStaged();        // True if the staged copy was taken back before it went live
+    bool isEditStaged();
+    Sequence *getEditSequence(); // The staged copy if any, else the playing sequence: where edits go
+    unsigned int getLoopCount();
 };
 
 #endif // SEQUENCE_PLAYER_H
@@ -0,0 +1,168 @@
+#ifndef SERIAL_PROTOCOL_H
+#define SERIAL_PROTOCOL_H
+
+#include <Arduino.h>
+#include "sequence.h"
+#include "sequence_player.h"
+#include "song.h"
+
+/*
+ * Binary pattern editing protocol over the USB serial link
+ *
+ * Every frame is COBS encoded and terminated by a 0x00 delimiter. Decoded, a
+ * frame is [command][payload...][crc16 hi][crc16 lo] where the CRC is
+ * CRC-16/CCITT-FALSE over command and payload. The unit answers every request
+ * with [command | 0x80][status][payload...][crc16], so hosts must wait for the
+ * reply before sending the next frame. That keeps at most one frame in the
+ * 64 byte hardware receive buffer.
+ *
+ * Gate durations are sent as 0-255 for 0.0-1.0, BPM as BPM * 10.
+ */
+
+const uint32_t PROTOCOL_BAUD = 115200;
+const uint8_t PROTOCOL_VERSION = 1;
+
+// Request commands
+enum ProtocolCommand
+{
+    CMD_PING = 0x01,          // -> [version]
+    CMD_GET_STEP = 0x02,      // [step] -> [step][note][gate]
+    CMD_SET_STEP = 0x03,      // [step][note][gate]
+    CMD_GET_PATTERN = 0x04,   // [offset][count] -> [length][offset][count]([note][gate])*count
+    CMD_SET_PATTERN = 0x05,   // [length][offset][count]([note][gate])*count, STATUS_BUSY while a song load holds the back buffer
+    CMD_TRANSPORT = 0x06,     // [action]
+    CMD_SET_BPM = 0x07,       // [bpm10 hi][bpm10 lo]
+    CMD_GET_TELEMETRY = 0x08, // -> [flags][step][length][bpm10 hi][bpm10 lo]
+    CMD_PROFILE = 0x09,       // -> text frames with the profiler dump, then the reply
+    CMD_SAVE_PATTERN = 0x0A,  // [slot] saves the playing pattern in the background
+    CMD_CUE_PATTERN = 0x0B,   // [slot] switches to a stored pattern at the next bar boundary
+    CMD_SET_SONG = 0x0C,      // [count]([pattern][repeats])*count
+    CMD_SONG = 0x0D,          // [0 stop, 1 start]
+    CMD_SET_CLOCK = 0x0E,     // [StepResolution][division][multiplication][beats per bar][beat unit]
+    CMD_TRACE = 0x0F,         // [0 stop, 1 start] input trace capture, see input_trace.h
+    CMD_SET_VOICE = 0x10,     // [AudioWaveform] audio voice waveform, see audio_voice.h
+    CMD_SET_DIRECTION = 0x11, // [PlaybackDirection][stride][rotation]
+    CMD_GET_MEMORY = 0x12,    // -> MemoryReport as 6 x [hi][lo], see memory_stats.h
+    CMD_GET_CHANGES = 0x13,   // [revision hi][lo][first step, 0 if left out] -> [revision hi][lo][length][steps first to first+31 changed since, 4 bytes MSB first]
+    CMD_SET_CV_INPUT = 0x14,  // [CvInputMode] CV input quantizer, see cv_input.h
+    CMD_SET_ENVELOPE = 0x15,  // [EnvelopeMode][attack][decay][sustain][release] see envelope.h
+    CMD_SYNC = 0x16,          // [SyncRole] or nothing -> [role][locked][phase us hi][lo][latency us hi][lo][skew ppm hi][lo]
+    CMD_SET_ARP = 0x17,       // [ArpMode][octaves] see arpeggiator.h
+    CMD_ARP_NOTE = 0x18,      // [note][1 held, 0 released], note 0xFF with 0 releases all
+    CMD_SET_VIEW = 0x19       // [zoom 0-3] display window of 16 << zoom steps, see ui_model.h
+};
+
+enum ProtocolTransport
+{
+    TRANSPORT_STOP = 0,
+    TRANSPORT_START = 1,
+    TRANSPORT_RESET = 2
+};
+
+enum ProtocolStatus
+{
+    STATUS_OK = 0,
+    STATUS_BAD_CRC = 1,
+    STATUS_UNKNOWN_COMMAND = 2,
+    STATUS_BAD_ARGUMENT = 3,
+    STATUS_UNSUPPORTED = 4,
+    STATUS_BUSY = 5
+};
+
+// Telemetry flag bits
+const uint8_t TELEMETRY_PLAYING = 0x01;
+const uint8_t TELEMETRY_SONG = 0x02;
+
+// Response command bit, and the command byte of unsolicited text frames
+const uint8_t RESPONSE_BIT = 0x80;
+const uint8_t FRAME_TRACE = 0xFD; // Input trace bytes, sent while a capture runs
+const uint8_t FRAME_TEXT = 0xFE;
+const uint8_t FRAME_ERROR = 0xFF; // Reply to a frame that could not be decoded
+
+// Changes reported by SerialProtocol::poll()
+const uint8_t PROTOCOL_CHANGED_PATTERN = 0x01;
+const uint8_t PROTOCOL_CHANGED_TRANSPORT = 0x02;
+const uint8_t PROTOCOL_CHANGED_VIEW = 0x04; // See getViewZoom()
+
+const uint8_t PROTOCOL_ZOOM_LEVELS = 4;
+
+// Frame sizes, a full 16 step chunk fits in one frame
+const uint8_t PROTOCOL_MAX_CHUNK_STEPS = 16;
+const uint8_t PROTOCOL_MAX_FRAME = 5 + PROTOCOL_MAX_CHUNK_STEPS * 2 + 2; // Decoded pattern reply, including CRC
+const uint8_t PROTOCOL_MAX_ENCODED = PROTOCOL_MAX_FRAME + 2;             // COBS overhead and delimiter
+
+// Framing helpers shared with host tools
+uint16_t crc16Update(uint16_t crc, uint8_t data);
+uint16_t crc16(const uint8_t *data, uint8_t length);
+uint8_t cobsEncode(const uint8_t *input, uint8_t length, uint8_t *output); // Appends the 0x00 delimiter
+
+class SyncLink;
+class Arpeggiator;
+
+// Incremental COBS decoder, fed one byte at a time
+class CobsDecoder
+{
+private:
+    uint8_t *buffer;
+    uint8_t capacity;
+    uint8_t length;
+    uint8_t remaining; // Data bytes left in the current block
+    bool pendingZero;  // Current block ends in an implicit zero
+    bool overflow;
+
+public:
+    CobsDecoder(uint8_t *frameBuffer, uint8_t bufferSize);
+    void reset();
+    // Returns true when a complete frame is available, check getLength() for its size (0 = invalid)
+    bool feed(uint8_t byte);
+    uint8_t getLength() { return length; }
+};
+
+class SerialProtocol
+{
+private:
+    static const uint8_t MAX_BYTES_PER_POLL = 16; // Bounded work per loop() iteration
+
+    Stream &stream;
+    SequencePlayer *player;   // Edits apply to the sequence the player is playing
+    Song *song;
+    SyncLink *syncLink;       // nullptr when the unit has no sync port
+    Arpeggiator *arpeggiator; // nullptr when the unit has no arpeggiator
+    uint8_t viewZoom;         // Requested display zoom, the application applies it
+    uint8_t frame[PROTOCOL_MAX_FRAME];
+    uint8_t reply[PROTOCOL_MAX_FRAME];
+    CobsDecoder decoder;
+
+    uint8_t handleFrame(uint8_t length);
+    void sendReply(uint8_t command, uint8_t status, uint8_t payloadLength);
+
+public:
+    SerialProtocol(Stream &port, SequencePlayer *seqPlayer, Song *patternSong);
+    void setSyncLink(SyncLink *link);
+    void setArpeggiator(Arpeggiator *arp);
+
+    // Parse pending input and answer at most one frame, returns PROTOCOL_CHANGED_* flags
+    uint8_t poll();
+    uint8_t getViewZoom() { return viewZoom; }
+
+    // Send an already assembled frame (without CRC)
+    void sendFrame(const uint8_t *data, uint8_t length);
+};
+
+// Print adapter that wraps text into FRAME_TEXT frames
+class FramedTextWriter : public Print
+{
+private:
+    static const uint8_t TEXT_CHUNK = 24;
+
+    SerialProtocol &protocol;
+    uint8_t buffer[1 + TEXT_CHUNK];
+    uint8_t length;
+
+public:
+    FramedTextWriter(SerialProtocol &target);
+    size_t write(uint8_t c) override;
+    void flush();
+};
+
+#endif // SERIAL_PROTOCOL_H
@@ -0,0 +1,85 @@
+#ifndef SONG_H
+#define SONG_H
+
+#include <stdint.h>
+#include "sequence.h"
+#include "sequence_player.h"
+#include "pattern_store.h"
+
+// One entry of the song chain: a stored pattern played a number of times
+struct SongEntry
+{
+    uint8_t pattern; // PatternStore slot
+    uint8_t repeats; // Times the pattern is played before moving on (at least 1)
+};
+
+/*
+ * Song mode and pattern switching
+ *
+ * Two Sequence buffers are used: the front one is playing, the back one is
+ * filled from the PatternStore in the background. Once it is loaded it is
+ * queued on the player, which swaps the pointers when the front pattern wraps,
+ * so the new pattern starts exactly on the bar boundary without a gap.
+ *
+ * While the back buffer is free it also takes bulk edits: beginEdit() copies
+ * the playing pattern into it, commitEdit() stages it on the player, which
+ * switches to it at the next step. Loads wait until that has happened. While
+ * the back buffer holds the next song pattern, or a save is reading the
+ * pattern, there is nowhere to put a bulk edit: beginEdit() returns nullptr
+ * and the caller tries again later or turns the edit down. Playback and saves
+ * never see a half-applied bulk edit.
+ */
+class Song
+{
+private:
+    static const int MAX_ENTRIES = 16;
+
+    PatternStore *store;
+    SequencePlayer *player;
+    Sequence *buffers[2];
+    uint8_t backIndex; // Buffer that is not playing
+
+    SongEntry entries[MAX_ENTRIES];
+    int numEntries;
+    bool chaining;     // Song mode active, otherwise only single cued patterns are switched
+    int entryIndex;    // Entry playing, -1 until the first entry has been swapped in
+    int nextEntry;     // Entry being preloaded into the back buffer
+    int repeatsLeft;   // Loops of the current entry still to play, including the current one
+    unsigned int lastLoopCount; // Player loop count already accounted for
+    int pendingSlot;   // Slot waiting for the store to become free, -1 if none
+    bool loading;      // Back buffer is being filled
+    bool wanted;       // Queue the back buffer once loading completes, cleared by stop()
+    bool backReady;    // Back buffer holds a complete pattern waiting to be queued
+    bool staging;      // Back buffer holds an edited copy staged on the player
+
+    void preload(int slot);
+    void tryPreload();
+    void onWrap(bool swapped, unsigned int wraps); // wraps: loops since the last update()
+
+public:
+    Song(PatternStore *patternStore, SequencePlayer *seqPlayer, Sequence *bufferA, Sequence *bufferB);
+
+    // Chain editing
+    void clear();
+    bool addEntry(uint8_t pattern, uint8_t repeats);
+    int getLength();
+
+    // Song playback, switching happens at the next bar boundary
+    bool start();
+    void stop();
+    bool isActive();
+    int getCurrentEntry();
+
+    // Switch to a single stored pattern at the next bar boundary, leaves song mode
+    bool cuePattern(int slot);
+
+    PatternStore *getStore();
+
+    // Bulk edits: edit the returned sequence, then always pass it to commitEdit(). nullptr while the back buffer is taken
+    Sequence *beginEdit();
+    void commitEdit(Sequence *edited);
+
+    void update(); // Call from loop(): advances store jobs and queues the next pattern
+};
+
+#endif // SONG_H
@@ -0,0 +1,138 @@
+#ifndef STEP_EVENTS_H
+#define STEP_EVENTS_H
+
+#include <stdint.h>
+#include "sequence_limits.h"
+
+/*
+ * Step event bus
+ *
+ * SequencePlayer reports every step by calling publishStepEvent(), a plain
+ * function the application defines, normally by forwarding to a
+ * StepEventBus. The bus is a list of subscriber types fixed at compile time,
+ * so every dispatch is a direct (usually inlined) call:
+ *
+ *   struct CvOut
+ *   {
+ *       static const StepPriority PRIORITY = STEP_REALTIME;
+ *       static void onStep(const StepEvent &event);
+ *   };
+ *   typedef StepEventBus<CvOut, GateOut, UiRefresh> StepBus;
+ *
+ *   void publishStepEvent(const StepEvent &event) { StepBus::publish(event); }
+ *   // and once per loop(): StepBus::runDeferred();
+ *
+ * Realtime subscribers run inside the player update, in list order, so put
+ * the outputs whose timing matters first. Deferred subscribers get the event
+ * from a small queue when the main loop calls runDeferred(), after the
+ * timing-critical work of that iteration is done.
+ */
+
+enum StepPriority
+{
+    STEP_REALTIME, // CV, gate, clock outputs: run at the step onset
+    STEP_DEFERRED  // UI, telemetry, persistence: run from the main loop
+};
+
+// Flag bits of StepEvent::flags
+const uint8_t STEP_EVENT_LOOP_START = 0x01; // First step of a pass through the sequence
+const uint8_t STEP_EVENT_BAR_START = 0x02;  // Step starts on the first tick of a bar
+const uint8_t STEP_EVENT_REST = 0x04;       // No note plays, the step only keeps time
+
+static_assert(MAX_SEQUENCE_LENGTH <= 256, "StepEvent::step must hold every step index");
+
+struct StepEvent
+{
+    uint8_t step;              // Step index in the sequence
+    uint8_t note;              // MIDI note of the step
+    uint8_t flags;             // STEP_EVENT_* bits
+    float gateDuration;        // Fraction of the step the gate stays open
+    float noteDurationSeconds; // Step length
+};
+
+// Provided by the application, see above
+void publishStepEvent(const StepEvent &event);
+
+// Subscriber list, unrolled recursively at compile time
+template <typename... Subscribers>
+struct StepSubscriberList;
+
+template <>
+struct StepSubscriberList<>
+{
+    static void dispatch(StepPriority, const StepEvent &) {}
+    static constexpr bool hasDeferred() { return false; }
+};
+
+template <typename First, typename... Rest>
+struct StepSubscriberList<First, Rest...>
+{
+    static void dispatch(StepPriority priority, const StepEvent &event)
+    {
+        // Both sides are constants after inlining, so the check costs nothing
+        if (First::PRIORITY == priority)
+        {
+            First::onStep(event);
+        }
+        StepSubscriberList<Rest...>::dispatch(priority, event);
+    }
+
+    static constexpr bool hasDeferred()
+    {
+        return First::PRIORITY == STEP_DEFERRED || StepSubscriberList<Rest...>::hasDeferred();
+    }
+};
+
+template <typename... Subscribers>
+class StepEventBus
+{
+private:
+    static const uint8_t QUEUE_SIZE = 4; // Must be a power of two
+
+    static StepEvent queue[QUEUE_SIZE];
+    static uint8_t head;
+    static uint8_t tail;
+    static uint8_t dropped;
+
+public:
+    static void publish(const StepEvent &event)
+    {
+        StepSubscriberList<Subscribers...>::dispatch(STEP_REALTIME, event);
+        if (!StepSubscriberList<Subscribers...>::hasDeferred())
+        {
+            return;
+        }
+
+        // A full queue means the loop stalled for several steps, the newest events are dropped
+        uint8_t next = (head + 1) & (QUEUE_SIZE - 1);
+        if (next == tail)
+        {
+            dropped++;
+            return;
+        }
+        queue[head] = event;
+        head = next;
+    }
+
+    static void runDeferred()
+    {
+        while (tail != head)
+        {
+            StepSubscriberList<Subscribers...>::dispatch(STEP_DEFERRED, queue[tail]);
+            tail = (tail + 1) & (QUEUE_SIZE - 1);
+        }
+    }
+
+    static uint8_t getDroppedCount() { return dropped; }
+};
+
+template <typename... Subscribers>
+StepEvent StepEventBus<Subscribers...>::queue[StepEventBus<Subscribers...>::QUEUE_SIZE];
+template <typename... Subscribers>
+uint8_t StepEventBus<Subscribers...>::head = 0;
+template <typename... Subscribers>
+uint8_t StepEventBus<Subscribers...>::tail = 0;
+template <typename... Subscribers>
+uint8_t StepEventBus<Subscribers...>::dropped = 0;
+
+#endif // STEP_EVENTS_H
@@ -0,0 +1,114 @@
+#ifndef SYNC_LINK_H
+#define SYNC_LINK_H
+
+#include <Arduino.h>
+#include "sequence_player.h"
+#include "serial_protocol.h"
+
+/*
+ * Clock sync between units over a UART
+ *
+ * The master broadcasts its clock position every SYNC_INTERVAL_TICKS master
+ * ticks and on every transport change, as COBS frames with the same CRC as
+ * the pattern protocol:
+ *
+ *   [SYNC_CLOCK][flags][tick 4][us into tick 2][tick period 3][ticks into step 2][play position][crc16]
+ *
+ * Followers timestamp each frame halfway between the poll() that reads it and
+ * the previous one, and add the link latency: the wire time of the frame plus
+ * any extra delay measured with SYNC_PING/SYNC_PONG round trips (the minimum
+ * of a window, so the master's loop delay mostly drops out). Links wired one
+ * way only use the wire time. The difference to the local position is the
+ * phase error, and a PI loop sets the local tick period from the master's:
+ * the integral term converges on the crystal skew between the units, the
+ * proportional term pulls the phase in over the next intervals. Errors beyond
+ * SYNC_RESYNC_MICROS, and every master start, stop or reset, jump straight to
+ * the master's position instead.
+ *
+ * Single arrival times are only as exact as the follower's loop period, the
+ * loop filter averages that out to well under a millisecond of phase error.
+ */
+
+const uint32_t SYNC_BAUD = 115200;
+const uint8_t SYNC_INTERVAL_TICKS = 24;               // Clock frame every 16th note
+const unsigned long SYNC_KEEPALIVE_MICROS = 250000UL; // Clock frame interval while stopped
+const unsigned long SYNC_PING_MICROS = 500000UL;      // Round trip measurement interval
+const int SYNC_LOCK_MICROS = 1000;                    // Phase error that counts as locked
+const long SYNC_RESYNC_MICROS = 20000L;               // Larger errors jump to the master's position
+
+enum SyncRole
+{
+    SYNC_OFF,
+    SYNC_MASTER,
+    SYNC_FOLLOWER,
+    NUM_SYNC_ROLES
+};
+
+// Frame types on the sync link
+enum SyncFrame
+{
+    SYNC_CLOCK = 0x01,
+    SYNC_PING = 0x02, // [id] follower to master
+    SYNC_PONG = 0x03  // [id] answered at once
+};
+
+const uint8_t SYNC_FLAG_PLAYING = 0x01;
+
+class SyncLink
+{
+private:
+    static const uint8_t CLOCK_FRAME = 16;     // Decoded clock frame including CRC
+    static const uint8_t PING_FRAME = 4;       // Decoded ping and pong frames including CRC
+    static const uint8_t PING_WINDOW = 8;      // Round trips per latency estimate
+    static const uint8_t LOCK_FRAMES = 4;      // Frames within SYNC_LOCK_MICROS before reporting lock
+    static const uint8_t MAX_BYTES_PER_POLL = 32;
+    static const uint8_t UNKNOWN_FLAGS = 0xFF; // No clock frame seen or sent yet
+
+    Stream &stream;
+    SequencePlayer *player;
+    SyncRole role;
+    uint8_t frame[CLOCK_FRAME];
+    CobsDecoder decoder;
+    unsigned long lastPollMicros;
+
+    // Master
+    uint8_t sentFlags;
+    unsigned long nextSyncTick;
+    unsigned long lastSendMicros;
+
+    // Follower
+    uint8_t masterFlags;
+    long frequencyOffset; // Integral term in 1/256 microseconds per tick, the skew estimate
+    long phaseError;      // Last measured error in microseconds, positive when ahead of the master
+    uint8_t lockCount;
+    uint8_t pingId;
+    bool pingPending;
+    unsigned long pingSentMicros;
+    unsigned long windowRoundTrip; // Shortest round trip in the current window
+    uint8_t windowCount;
+    unsigned int linkDelay; // One-way delay beyond the wire time in microseconds
+
+    static unsigned int wireMicros(uint8_t frameLength); // COBS adds two bytes to a short frame
+
+    void sendFrame(uint8_t *data, uint8_t length); // Appends the CRC, data needs 2 spare bytes
+    void handleFrame(uint8_t length, unsigned long nowMicros, unsigned long waitMicros);
+    void handleClock(unsigned long waitMicros); // waitMicros: estimated time since the frame arrived
+    void handlePong(unsigned long arrivalMicros);
+    void sendClock(unsigned long nowMicros);
+
+public:
+    SyncLink(Stream &port, SequencePlayer *seqPlayer);
+
+    void setRole(SyncRole newRole);
+    SyncRole getRole();
+
+    // Call right after the player update, with the micros() value it was updated to
+    void poll(unsigned long nowMicros);
+
+    bool isLocked();
+    long getPhaseError();      // Microseconds, positive when this unit is ahead
+    unsigned int getLatency(); // Assumed clock frame latency in microseconds
+    long getSkewPpm();         // Tick period correction against the master's
+};
+
+#endif // SYNC_LINK_H
@@ -0,0 +1,74 @@
+#ifndef UI_MODEL_H
+#define UI_MODEL_H
+
+#include <U8g2lib.h>
+#include "sequence.h"
+
+/*
+ * Everything drawUI() puts on screen, computed once per frame
+ *
+ * The display runs in page buffer mode and draws one 8 pixel page per call
+ * (8 per frame, see Display). All scans, mapping and text formatting happen
+ * in the setters; renderPage() only rasterizes from this struct and skips
+ * every primitive that does not touch the page being drawn. Bars are only
+ * recomputed for the steps the sequence's change journal reports as edited.
+ *
+ * The sequence is drawn as a window of up to MAX_COLUMNS columns that pages
+ * along with the playing step. The zoom level sets how many steps the window
+ * spans (16 << zoom); patterns shorter than that are fitted to the screen.
+ * When a column spans several steps it shows the range of their notes, from
+ * the highest to the lowest. Work per frame is bounded by the screen width,
+ * at most MAX_WINDOW_STEPS steps are read however long the pattern is.
+ */
+class UiModel
+{
+public:
+    static const uint8_t MAX_COLUMNS = 32;   // At least 4 pixels per column
+    static const uint8_t NUM_ZOOM_LEVELS = 4; // Window of 16, 32, 64 or 128 steps
+    static const int MAX_WINDOW_STEPS = 16 << (NUM_ZOOM_LEVELS - 1);
+    static const uint8_t NO_COLUMN = 0xFF;
+
+    // Layout
+    static const uint8_t HEADER_BASELINE = 8;
+    static const uint8_t FOOTER_BASELINE = 64;
+    static const uint8_t TEXT_HEIGHT = 10; // u8g2_font_6x10_tf, measured up from the baseline
+    static const uint8_t SEQ_TOP = 10;     // Room for the header text
+    static const uint8_t SEQ_HEIGHT = 64 - 20;
+    static const uint8_t SEQ_BOTTOM = SEQ_TOP + SEQ_HEIGHT;
+    static const uint8_t MIN_BAR_HEIGHT = 3;
+
+    char header[24];   // BPM or scale, empty when hidden
+    char indicator[4]; // Record mode, empty when not recording
+    char stepLabel[8]; // "current/length"
+    char noteLabel[5]; // Name of the note at the current step
+
+    // Sequence window, one bar per column
+    uint8_t numColumns;
+    uint8_t columnWidth;
+    uint8_t stepsPerColumn;
+    uint8_t currentColumn;          // Column of the playing step, NO_COLUMN when outside the window
+    uint8_t barTop[MAX_COLUMNS];    // Top of the highest note
+    uint8_t barBottom[MAX_COLUMNS]; // SEQ_BOTTOM, or just below the lowest note when decimated
+    uint8_t barWidth[MAX_COLUMNS];
+
+private:
+    Sequence *stepsSource;  // Sequence the bars were computed from
+    uint16_t stepsRevision; // Its revision at that time
+    int windowStart;        // First step in the window
+    int windowSteps;        // Steps the window spans
+    uint8_t zoom;
+    uint8_t lowestNote;     // Note range of the window the bar heights are scaled to
+    uint8_t highestNote;
+
+    uint8_t noteTop(int note) const;
+    void setColumn(Sequence &sequence, uint8_t column, int windowEnd);
+
+public:
+    UiModel();
+    void setZoom(uint8_t level); // 0 to NUM_ZOOM_LEVELS - 1, applied by the next setSteps()
+    uint8_t getZoom();
+    void setSteps(Sequence &sequence, int playingStep);
+    void renderPage(U8G2 &u8g2) const; // Draws the part on the page u8g2 is buffering
+};
+
+#endif // UI_MODEL_H
@@ -0,0 +1,272 @@
+#include <Arduino.h>
+#include "arpeggiator.h"
+
+// Bit scans on a non-zero value, __builtin_clz counts over a whole unsigned int
+static inline uint8_t lowestBit(unsigned int bits)
+{
+    return __builtin_ctz(bits);
+}
+
+static inline uint8_t highestBit(unsigned int bits)
+{
+    return sizeof(unsigned int) * 8 - 1 - __builtin_clz(bits);
+}
+
+Arpeggiator::Arpeggiator()
+    : heldBytes(0), orderStart(0), count(0), mode(ARP_OFF), octaves(1), octave(0), lastNote(-1), orderIndex(-1),
+      ascending(true)
+{
+    memset(held, 0, sizeof(held));
+}
+
+void Arpeggiator::setMode(ArpMode newMode)
+{
+    if (newMode < NUM_ARP_MODES)
+    {
+        mode = newMode;
+        restart();
+    }
+}
+
+ArpMode Arpeggiator::getMode()
+{
+    return mode;
+}
+
+void Arpeggiator::setOctaves(uint8_t range)
+{
+    octaves = constrain(range, 1, MAX_OCTAVES);
+    restart();
+}
+
+uint8_t Arpeggiator::getOctaves()
+{
+    return octaves;
+}
+
+void Arpeggiator::restart()
+{
+    // The next note is the first of the pattern
+    bool down = mode == ARP_DOWN;
+    octave = down ? octaves - 1 : 0;
+    lastNote = down ? 128 : -1;
+    orderIndex = -1;
+    ascending = true;
+}
+
+bool Arpeggiator::isHeld(uint8_t note)
+{
+    return held[note >> 3] & (1 << (note & 7));
+}
+
+void Arpeggiator::noteOn(uint8_t note)
+{
+    if (note > 127 || isHeld(note))
+    {
+        return;
+    }
+    if (count == MAX_HELD)
+    {
+        noteOff(order[orderStart]);
+    }
+    if (count == 0)
+    {
+        restart(); // A new chord starts from the beginning of the pattern
+    }
+
+    held[note >> 3] |= 1 << (note & 7);
+    heldBytes |= 1U << (note >> 3);
+    order[(orderStart + count) % MAX_HELD] = note;
+    count++;
+}
+
+void Arpeggiator::noteOff(uint8_t note)
+{
+    if (note > 127 || !isHeld(note))
+    {
+        return;
+    }
+    held[note >> 3] &= ~(1 << (note & 7));
+    if (held[note >> 3] == 0)
+    {
+        heldBytes &= ~(1U << (note >> 3));
+    }
+    removeFromOrder(note);
+}
+
+void Arpeggiator::removeFromOrder(uint8_t note)
+{
+    // At most MAX_HELD entries, and only on note input, never per step
+    uint8_t removed = 0;
+    while (removed < count && order[(orderStart + removed) % MAX_HELD] != note)
+    {
+        removed++;
+    }
+    if (removed == 0)
+    {
+        orderStart = (orderStart + 1) % MAX_HELD; // The oldest note, also when the ring is full
+    }
+    else
+    {
+        for (uint8_t i = removed; i + 1 < count; i++)
+        {
+            order[(orderStart + i) % MAX_HELD] = order[(orderStart + i + 1) % MAX_HELD];
+        }
+    }
+    count--;
+
+    // Keep the as-played position on the note that follows the removed one
+    if (orderIndex >= (int8_t)removed)
+    {
+        orderIndex--;
+    }
+}
+
+void Arpeggiator::releaseAll()
+{
+    memset(held, 0, sizeof(held));
+    heldBytes = 0;
+    count = 0;
+    restart();
+}
+
+int Arpeggiator::findUp(int from)
+{
+    if (from > 127)
+    {
+        return -1;
+    }
+    from = from < 0 ? 0 : from;
+    uint8_t index = from >> 3;
+    uint8_t bits = held[index] & (0xFF << (from & 7));
+    if (bits == 0)
+    {
+        unsigned int above = heldBytes & (0xFFFEU << index);
+        if (above == 0)
+        {
+            return -1;
+        }
+        index = lowestBit(above);
+        bits = held[index];
+    }
+    return (index << 3) + lowestBit(bits);
+}
+
+int Arpeggiator::findDown(int from)
+{
+    if (from < 0)
+    {
+        return -1;
+    }
+    from = from > 127 ? 127 : from;
+    uint8_t index = from >> 3;
+    uint8_t bits = held[index] & (0xFF >> (7 - (from & 7)));
+    if (bits == 0)
+    {
+        unsigned int below = heldBytes & ((1U << index) - 1);
+        if (below == 0)
+        {
+            return -1;
+        }
+        index = highestBit(below);
+        bits = held[index];
+    }
+    return (index << 3) + highestBit(bits);
+}
+
+bool Arpeggiator::stepUp()
+{
+    int note = findUp(lastNote + 1);
+    if (note < 0)
+    {
+        if (octave + 1 >= octaves)
+        {
+            return false;
+        }
+        octave++;
+        note = findUp(0);
+    }
+    lastNote = note;
+    return true;
+}
+
+bool Arpeggiator::stepDown()
+{
+    int note = findDown(lastNote - 1);
+    if (note < 0)
+    {
+        if (octave == 0)
+        {
+            return false;
+        }
+        octave--;
+        note = findDown(127);
+    }
+    lastNote = note;
+    return true;
+}
+
+int Arpeggiator::nextNote()
+{
+    if (count == 0)
+    {
+        return -1;
+    }
+
+    switch (mode)
+    {
+    case ARP_DOWN:
+        if (!stepDown())
+        {
+            restart();
+            stepDown();
+        }
+        break;
+
+    case ARP_UP_DOWN:
+        if (ascending && !stepUp())
+        {
+            ascending = false;
+        }
+        if (!ascending && !stepDown())
+        {
+            // Back at the bottom, turn around without repeating it
+            ascending = true;
+            if (!stepUp())
+            {
+                restart(); // A single note in one octave
+                stepUp();
+            }
+        }
+        break;
+
+    case ARP_AS_PLAYED:
+        if (++orderIndex >= (int8_t)count)
+        {
+            orderIndex = 0;
+            octave = octave + 1 < octaves ? octave + 1 : 0;
+        }
+        lastNote = order[(orderStart + orderIndex) % MAX_HELD];
+        break;
+
+    case ARP_RANDOM:
+        lastNote = order[(orderStart + random(count)) % MAX_HELD];
+        octave = random(octaves);
+        break;
+
+    default: // ARP_UP, also used when off
+        if (!stepUp())
+        {
+            restart();
+            stepUp();
+        }
+        break;
+    }
+
+    int note = lastNote + 12 * octave;
+    while (note > 127)
+    {
+        note -= 12;
+    }
+    return note;
+}
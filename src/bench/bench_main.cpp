@@ -0,0 +1,132 @@
+/*
+ * Benchmark firmware (env:bench), run under simavr by tools/bench/run.sh
+ *
+ * Builds the real firmware objects and main.cpp (its setup() and loop() are
+ * renamed so this file provides the entry points) and times the hot paths
+ * with cycle markers, see bench_markers.h. The power-up time is counted by
+ * the runner from reset to the first rising edge on the gate pin, the end of
+ * setup() is marked as well for comparison. Timer0 is stopped while measuring
+ * so millis() interrupts don't land in the counts, only the TWI interrupt
+ * that drawUI() depends on stays enabled.
+ */
+
+#define setup firmwareSetup
+#define loop firmwareLoop
+#include "../main.cpp"
+#undef setup
+#undef loop
+
+#include "hardware/twi.h"
+#include "bench_markers.h"
+
+extern char __heap_start;
+
+static_assert(Board::GATE_PIN == 8, "bench_markers.h probes PB0 for the first gate edge");
+
+static const int RUNS = 16; // Measurements per benchmark, the runner reports min/mean/max
+
+static inline void benchBegin(uint8_t id)
+{
+  GPIOR1 = id;
+  GPIOR0 = BENCH_MARK_BEGIN;
+}
+
+static inline void benchEnd()
+{
+  GPIOR0 = BENCH_MARK_END;
+}
+
+void setup()
+{
+  firmwareSetup();
+  GPIOR0 = BENCH_MARK_BOOT;
+
+  // Deferred startup, brings up the display the serviceDisplay() benchmark draws to
+  while (!advanceBoot())
+  {
+  }
+  Twi::flush();
+  TIMSK0 &= ~(1 << TOIE0);
+
+  for (int i = 0; i < RUNS; i++)
+  {
+    benchBegin(BENCH_OVERHEAD);
+    benchEnd();
+  }
+
+  // Short updates that stay inside the current step
+  player.setCurrentStep(0);
+  for (int i = 0; i < RUNS; i++)
+  {
+    benchBegin(BENCH_PLAYER_UPDATE);
+    player.updateMicros(100);
+    benchEnd();
+  }
+
+  // Updates that cross into the next step and run the realtime step subscribers
+  for (int i = 0; i < RUNS; i++)
+  {
+    benchBegin(BENCH_PLAYER_STEP);
+    player.updateMicros((player.getStepTicks() * player.getTickPeriod() >> SequencePlayer::TICK_FRACTION_BITS) + 1);
+    benchEnd();
+    StepBus::runDeferred();
+    Twi::flush();
+  }
+
+  activeSequence().setLength(16);
+  for (int i = 0; i < RUNS; i++)
+  {
+    benchBegin(BENCH_TRANSPOSE);
+    activeSequence().transpose(i & 1 ? -1 : 1);
+    benchEnd();
+  }
+
+  for (int i = 0; i < RUNS; i++)
+  {
+    benchBegin(BENCH_RANDOMIZE);
+    activeSequence().randomize(BASE_0V_NOTE, 3, i % 10);
+    benchEnd();
+  }
+
+  for (int i = 0; i < RUNS; i++)
+  {
+    benchBegin(BENCH_SET_CV_NOTE);
+    setCVNote(BASE_0V_NOTE + i * 3);
+    benchEnd();
+  }
+
+  for (int i = 0; i < RUNS; i++)
+  {
+    benchBegin(BENCH_POT_UPDATE);
+    timingPot.update(0.01f);
+    benchEnd();
+  }
+
+  // One page per call, the first of every 8 also computes the model
+  for (int i = 0; i < RUNS; i++)
+  {
+    drawUI();
+    benchBegin(BENCH_DRAW_UI);
+    serviceDisplay();
+    benchEnd();
+    Twi::flush();
+  }
+
+  player.stop();
+  for (int i = 0; i < RUNS; i++)
+  {
+    benchBegin(BENCH_MAIN_UPDATE);
+    update(1000);
+    benchEnd();
+    Twi::flush();
+  }
+
+  uint16_t heapStart = (uint16_t)(uintptr_t)&__heap_start;
+  GPIOR1 = heapStart & 0xFF;
+  GPIOR2 = heapStart >> 8;
+  GPIOR0 = BENCH_MARK_DONE;
+}
+
+void loop()
+{
+}
@@ -0,0 +1,42 @@
+#ifndef BENCH_MARKERS_H
+#define BENCH_MARKERS_H
+
+/*
+ * Markers shared by the benchmark firmware and the simavr runner
+ *
+ * The firmware writes the benchmark id to GPIOR1 and then a marker to GPIOR0.
+ * The runner watches GPIOR0 writes and counts the exact cycles between
+ * BENCH_MARK_BEGIN and BENCH_MARK_END. Both writes are single `out`
+ * instructions, and their cost is measured by BENCH_OVERHEAD and subtracted.
+ */
+
+// GPIOR0 values
+#define BENCH_MARK_BEGIN 1
+#define BENCH_MARK_END 2
+#define BENCH_MARK_DONE 3 // GPIOR1/GPIOR2 hold the end of static RAM (__heap_start)
+#define BENCH_MARK_BOOT 4 // setup() has returned
+
+// Gate output the runner watches for the end of power-up, Board::GATE_PIN on the Uno (pin 8)
+#define BENCH_GATE_PORT 'B'
+#define BENCH_GATE_BIT 0
+
+// Data space addresses of the general purpose I/O registers on the ATmega328P
+#define BENCH_GPIOR0_ADDRESS 0x3E
+#define BENCH_GPIOR1_ADDRESS 0x4A
+#define BENCH_GPIOR2_ADDRESS 0x4B
+
+enum BenchId
+{
+    BENCH_OVERHEAD,      // Empty measurement
+    BENCH_PLAYER_UPDATE, // SequencePlayer::update() without a step change
+    BENCH_PLAYER_STEP,   // SequencePlayer::update() that advances a step, including the realtime step subscribers
+    BENCH_TRANSPOSE,     // Sequence::transpose() on 16 steps
+    BENCH_RANDOMIZE,     // Sequence::randomize() on 16 steps
+    BENCH_SET_CV_NOTE,   // setCVNote()
+    BENCH_POT_UPDATE,    // Pot::update() with an ADC read
+    BENCH_DRAW_UI,       // One serviceDisplay() page, until it returns (bus transfer runs on in the TWI interrupt)
+    BENCH_MAIN_UPDATE,   // main.cpp update() for a 1ms loop
+    BENCH_COUNT
+};
+
+#endif // BENCH_MARKERS_H
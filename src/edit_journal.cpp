@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include <string.h>
+#include "edit_journal.h"
+#include "sequence.h"
+
+EditJournal::EditJournal() : owner(nullptr)
+{
+    clear();
+}
+
+void EditJournal::clear()
+{
+    oldest = 0;
+    undoCount = 0;
+    redoCount = 0;
+    groupKey = EDIT_KEY_NONE;
+    memset(groupSteps, 0, sizeof(groupSteps));
+    groupStart = true;
+    discarding = false;
+}
+
+void EditJournal::forget(Sequence *sequence)
+{
+    if (sequence == owner)
+    {
+        clear();
+        owner = nullptr;
+    }
+}
+
+void EditJournal::beginEdit(Sequence *sequence, uint16_t key)
+{
+    if (sequence != owner)
+    {
+        clear();
+        owner = sequence;
+    }
+
+    // Repeated edits of the same kind keep adding to the open edit
+    if (key != EDIT_KEY_NONE && key == groupKey && redoCount == 0)
+    {
+        return;
+    }
+    groupKey = key;
+    memset(groupSteps, 0, sizeof(groupSteps));
+    groupStart = true;
+    discarding = false;
+}
+
+void EditJournal::record(uint8_t step, int note, float gate)
+{
+    // Only the value before the first change of a step in an edit is needed
+    uint8_t bit = step < MAX_SEQUENCE_LENGTH ? step : MAX_SEQUENCE_LENGTH;
+    uint8_t &steps = groupSteps[bit >> 3];
+    uint8_t stepMask = 1 << (bit & 7);
+    if (discarding || (steps & stepMask))
+    {
+        return;
+    }
+    steps |= stepMask;
+    redoCount = 0; // A new edit replaces what was undone
+
+    if (undoCount == SIZE)
+    {
+        // Drop the oldest edit as a whole, a partly undone edit would leave a mixed pattern
+        do
+        {
+            oldest = (oldest + 1) % SIZE;
+            undoCount--;
+        } while (undoCount > 0 && !(entryAt(0).gate & JOURNAL_GROUP_START));
+
+        if (undoCount == 0 && !groupStart)
+        {
+            // The open edit itself filled the ring
+            discarding = true;
+            return;
+        }
+    }
+
+    JournalEntry &entry = entryAt(undoCount);
+    entry.step = step;
+    entry.note = note;
+    entry.gate = packGate(gate) | (groupStart ? JOURNAL_GROUP_START : 0);
+    groupStart = false;
+    undoCount++;
+}
+
+void EditJournal::undo(Sequence *sequence)
+{
+    // Newest entry first, so a step saved twice ends on its oldest value
+    groupKey = EDIT_KEY_NONE;
+    bool first;
+    do
+    {
+        undoCount--;
+        redoCount++;
+        first = entryAt(undoCount).gate & JOURNAL_GROUP_START;
+        sequence->swapEntry(entryAt(undoCount));
+    } while (!first && undoCount > 0);
+}
+
+void EditJournal::redo(Sequence *sequence)
+{
+    groupKey = EDIT_KEY_NONE;
+    do
+    {
+        sequence->swapEntry(entryAt(undoCount));
+        undoCount++;
+        redoCount--;
+    } while (redoCount > 0 && !(entryAt(undoCount).gate & JOURNAL_GROUP_START));
+}
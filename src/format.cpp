@@ -0,0 +1,94 @@
+#include "format.h"
+
+// Two characters per note name, a space means no accidental
+static const char noteNames[] PROGMEM = "C C#D D#E F F#G G#A A#B ";
+
+static const char scaleMajor[] PROGMEM = "Major";
+static const char scaleMinor[] PROGMEM = "Minor";
+static const char scaleHarmonicMinor[] PROGMEM = "Harm Min";
+static const char scaleLydian[] PROGMEM = "Lydian";
+static const char scaleMixolydian[] PROGMEM = "Mixolyd";
+static const char scaleDorian[] PROGMEM = "Dorian";
+static const char scalePhrygian[] PROGMEM = "Phrygian";
+static const char scalePentatonicMajor[] PROGMEM = "Pent Maj";
+static const char scalePentatonicMinor[] PROGMEM = "Pent Min";
+static const char scaleBlues[] PROGMEM = "Blues";
+static const char scaleUnknown[] PROGMEM = "Unknown";
+
+static const char *const scaleNames[NUM_SCALES] PROGMEM = {
+    scaleMajor, scaleMinor, scaleHarmonicMinor, scaleLydian, scaleMixolydian,
+    scaleDorian, scalePhrygian, scalePentatonicMajor, scalePentatonicMinor, scaleBlues};
+
+char *formatUInt(char *buffer, unsigned int value)
+{
+    // Digits come out in reverse, write them to a scratch area first. 5 digits per
+    // 2 bytes covers 65535 on AVR and 4294967295 on hosts with a 32 bit int
+    char digits[sizeof(unsigned int) * 5 / 2];
+    uint8_t count = 0;
+    do
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    while (count > 0)
+    {
+        *buffer++ = digits[--count];
+    }
+    *buffer = '\0';
+    return buffer;
+}
+
+char *formatInt(char *buffer, int value)
+{
+    if (value < 0)
+    {
+        *buffer++ = '-';
+        return formatUInt(buffer, -(long)value);
+    }
+    return formatUInt(buffer, value);
+}
+
+char *formatTenths(char *buffer, unsigned int tenths)
+{
+    buffer = formatUInt(buffer, tenths / 10);
+    *buffer++ = '.';
+    *buffer++ = '0' + tenths % 10;
+    *buffer = '\0';
+    return buffer;
+}
+
+char *formatNoteName(char *buffer, int midiNote)
+{
+    midiNote = constrain(midiNote, 0, 127);
+    int note = midiNote % 12;         // Get note within octave (0-11)
+    int octave = (midiNote / 12) - 1; // Calculate octave (-1 to 9 for MIDI range 0-127)
+
+    *buffer++ = pgm_read_byte(&noteNames[note * 2]);
+    char accidental = pgm_read_byte(&noteNames[note * 2 + 1]);
+    if (accidental != ' ')
+    {
+        *buffer++ = accidental;
+    }
+    return formatInt(buffer, octave);
+}
+
+char *formatScaleName(char *buffer, int scaleType)
+{
+    if (scaleType >= 0 && scaleType < NUM_SCALES)
+    {
+        return formatString_P(buffer, (const char *)pgm_read_ptr(&scaleNames[scaleType]));
+    }
+    return formatString_P(buffer, scaleUnknown);
+}
+
+char *formatString_P(char *buffer, const char *progmemStr)
+{
+    char c;
+    while ((c = pgm_read_byte(progmemStr++)) != '\0')
+    {
+        *buffer++ = c;
+    }
+    *buffer = '\0';
+    return buffer;
+}
@@ -0,0 +1,159 @@
+#include "hardware/audio_voice.h"
+
+#ifdef ENABLE_AUDIO_VOICE
+
+#include <util/atomic.h>
+
+// Phase increment for a frequency in Hz, evaluated by the compiler
+#define DDS_INCREMENT(hz) ((uint32_t)((hz) * 16777216.0 / AUDIO_SAMPLE_RATE + 0.5))
+
+// Increments for the octave of MIDI notes 120-131, lower octaves are right shifts
+static const uint32_t topOctaveIncrements[12] PROGMEM = {
+    DDS_INCREMENT(8372.018),   // C
+    DDS_INCREMENT(8869.844),   // C#
+    DDS_INCREMENT(9397.273),   // D
+    DDS_INCREMENT(9956.063),   // D#
+    DDS_INCREMENT(10548.082),  // E
+    DDS_INCREMENT(11175.303),  // F
+    DDS_INCREMENT(11839.822),  // F#
+    DDS_INCREMENT(12543.854),  // G
+    DDS_INCREMENT(13289.750),  // G#
+    DDS_INCREMENT(14080.000),  // A
+    DDS_INCREMENT(14917.240),  // A#
+    DDS_INCREMENT(15804.266)   // B
+};
+
+// One cycle per table, sine, triangle and saw start at the midline
+static const uint8_t sineTable[256] PROGMEM = {
+    128, 131, 134, 137, 140, 144, 147, 150, 153, 156, 159, 162, 165, 168, 171, 174,
+    177, 179, 182, 185, 188, 191, 193, 196, 199, 201, 204, 206, 209, 211, 213, 216,
+    218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 239, 240, 241, 243, 244,
+    245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+    255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+    245, 244, 243, 241, 240, 239, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+    218, 216, 213, 211, 209, 206, 204, 201, 199, 196, 193, 191, 188, 185, 182, 179,
+    177, 174, 171, 168, 165, 162, 159, 156, 153, 150, 147, 144, 140, 137, 134, 131,
+    128, 125, 122, 119, 116, 112, 109, 106, 103, 100, 97, 94, 91, 88, 85, 82,
+    79, 77, 74, 71, 68, 65, 63, 60, 57, 55, 52, 50, 47, 45, 43, 40,
+    38, 36, 34, 32, 30, 28, 26, 24, 22, 21, 19, 17, 16, 15, 13, 12,
+    11, 10, 8, 7, 6, 6, 5, 4, 3, 3, 2, 2, 2, 1, 1, 1,
+    1, 1, 1, 1, 2, 2, 2, 3, 3, 4, 5, 6, 6, 7, 8, 10,
+    11, 12, 13, 15, 16, 17, 19, 21, 22, 24, 26, 28, 30, 32, 34, 36,
+    38, 40, 43, 45, 47, 50, 52, 55, 57, 60, 63, 65, 68, 71, 74, 77,
+    79, 82, 85, 88, 91, 94, 97, 100, 103, 106, 109, 112, 116, 119, 122, 125};
+
+static const uint8_t triangleTable[256] PROGMEM = {
+    128, 130, 132, 134, 136, 138, 140, 142, 144, 146, 148, 150, 152, 154, 156, 158,
+    160, 162, 164, 166, 168, 170, 172, 174, 176, 178, 180, 182, 184, 186, 188, 190,
+    192, 194, 196, 198, 200, 202, 204, 206, 208, 210, 212, 214, 216, 218, 220, 222,
+    224, 226, 228, 230, 232, 234, 236, 238, 240, 242, 244, 246, 248, 250, 252, 254,
+    255, 253, 251, 249, 247, 245, 243, 241, 239, 237, 235, 233, 231, 229, 227, 225,
+    223, 221, 219, 217, 215, 213, 211, 209, 207, 205, 203, 201, 199, 197, 195, 193,
+    191, 189, 187, 185, 183, 181, 179, 177, 175, 173, 171, 169, 167, 165, 163, 161,
+    159, 157, 155, 153, 151, 149, 147, 145, 143, 141, 139, 137, 135, 133, 131, 129,
+    127, 125, 123, 121, 119, 117, 115, 113, 111, 109, 107, 105, 103, 101, 99, 97,
+    95, 93, 91, 89, 87, 85, 83, 81, 79, 77, 75, 73, 71, 69, 67, 65,
+    63, 61, 59, 57, 55, 53, 51, 49, 47, 45, 43, 41, 39, 37, 35, 33,
+    31, 29, 27, 25, 23, 21, 19, 17, 15, 13, 11, 9, 7, 5, 3, 1,
+    0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30,
+    32, 34, 36, 38, 40, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62,
+    64, 66, 68, 70, 72, 74, 76, 78, 80, 82, 84, 86, 88, 90, 92, 94,
+    96, 98, 100, 102, 104, 106, 108, 110, 112, 114, 116, 118, 120, 122, 124, 126};
+
+static const uint8_t sawTable[256] PROGMEM = {
+    128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142, 143,
+    144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159,
+    160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172, 173, 174, 175,
+    176, 177, 178, 179, 180, 181, 182, 183, 184, 185, 186, 187, 188, 189, 190, 191,
+    192, 193, 194, 195, 196, 197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207,
+    208, 209, 210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222, 223,
+    224, 225, 226, 227, 228, 229, 230, 231, 232, 233, 234, 235, 236, 237, 238, 239,
+    240, 241, 242, 243, 244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+    32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+    48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+    64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79,
+    80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95,
+    96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111,
+    112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127};
+
+static const uint8_t squareTable[256] PROGMEM = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+static const uint8_t *const waveTables[NUM_WAVEFORMS] PROGMEM = {sawTable, squareTable, triangleTable, sineTable};
+
+AudioWaveform AudioVoice::waveform = WAVE_SAW;
+const uint8_t *AudioVoice::wavetable = sineTable;
+__uint24 AudioVoice::phase = 0;
+__uint24 AudioVoice::increment = 0;
+bool AudioVoice::sounding = false;
+
+void AudioVoice::begin()
+{
+    Board::AudioPin::output();
+    OCR2A = 128;
+    TCCR2A |= 1 << COM2A1; // Non-inverting PWM on OC2A
+    Timer2::begin();
+}
+
+void AudioVoice::setWaveform(AudioWaveform newWaveform)
+{
+    if (newWaveform >= NUM_WAVEFORMS)
+    {
+        return;
+    }
+    waveform = newWaveform;
+    if (sounding)
+    {
+        const uint8_t *table = (const uint8_t *)pgm_read_ptr(&waveTables[waveform]);
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            wavetable = table;
+        }
+    }
+}
+
+void AudioVoice::noteOn(int midiNote)
+{
+    midiNote = constrain(midiNote, 0, 127);
+    uint8_t octave = midiNote / 12;
+    __uint24 noteIncrement = pgm_read_dword(&topOctaveIncrements[midiNote % 12]) >> (10 - octave);
+    const uint8_t *table = (const uint8_t *)pgm_read_ptr(&waveTables[waveform]);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        phase = 0;
+        increment = noteIncrement;
+        wavetable = table;
+    }
+    sounding = true;
+}
+
+void AudioVoice::noteOff()
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        phase = 0;
+        increment = 0;
+        wavetable = sineTable; // Sample 0 of the sine is the midline
+    }
+    sounding = false;
+}
+
+#endif // ENABLE_AUDIO_VOICE
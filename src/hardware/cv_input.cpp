@@ -0,0 +1,144 @@
+#include "hardware/cv_input.h"
+#include "scales.h"
+
+// ADC reading at which each semitone above 0V begins, midway between the
+// ideal 1V/oct readings. Trim entries to calibrate a unit's input divider.
+static const uint16_t semitoneThresholds[CvInput::SEMITONES] PROGMEM = {
+    9, 26, 43, 60, 77, 94, 111, 128, 145, 162, 179, 196,         // 0V
+    213, 230, 247, 264, 281, 298, 315, 332, 350, 367, 384, 401,  // 1V
+    418, 435, 452, 469, 486, 503, 520, 537, 554, 571, 588, 605,  // 2V
+    622, 639, 656, 673, 691, 708, 725, 742, 759, 776, 793, 810,  // 3V
+    827, 844, 861, 878, 895, 912, 929, 946, 963, 980, 997, 1014, // 4V
+};
+
+volatile CvInputMode CvInput::mode = CV_IN_OFF;
+volatile uint8_t CvInput::scale = 0;
+bool CvInput::triggerLevel = false;
+uint32_t CvInput::compareStep = 0;
+
+#ifdef __AVR__
+
+#include <avr/interrupt.h>
+
+// Pin change interrupt of the trigger pin, PORTD on the Uno and PORTC on the ATmega1284P,
+// both pin change group 2
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega1284P__)
+#define TRIGGER_PCINT_vect PCINT2_vect
+#define TRIGGER_PCMSK PCMSK2
+#define TRIGGER_PCIE PCIE2
+#endif
+
+// ADC clock bits of ADCSRA, CPU_HZ / 32 for the CV reading
+#define ADC_PRESCALER_MASK ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))
+#define ADC_PRESCALER_32 ((1 << ADPS2) | (1 << ADPS0))
+
+void CvInput::begin()
+{
+    Board::TriggerPin::input();
+    triggerLevel = Board::TriggerPin::read();
+
+    // Pitch CV compare value per semitone in 16.16 fixed point, so the interrupt does not divide
+    compareStep = ((uint32_t)Board::CvPwm::getTop() << 16) / SEMITONES;
+
+    TRIGGER_PCMSK |= Board::TriggerPin::MASK;
+    PCICR |= 1 << TRIGGER_PCIE;
+}
+
+int CvInput::guardedAnalogRead(uint8_t pin)
+{
+    // An edge meanwhile stays flagged in PCIFR and is handled once the interrupt is enabled again
+    uint8_t savedControl = PCICR;
+    PCICR = savedControl & ~(1 << TRIGGER_PCIE);
+    int value = analogRead(pin);
+    PCICR = savedControl;
+    return value;
+}
+
+int CvInput::readAdc()
+{
+    // Main loop readings hold the trigger interrupt off (guardedAnalogRead()), so no
+    // result is pending here. The setup is restored so nobody else sees the faster clock.
+    while (ADCSRA & (1 << ADSC))
+    {
+    }
+    uint8_t savedMux = ADMUX;
+    uint8_t savedControl = ADCSRA & ~(1 << ADIF); // Writing ADIF as 1 would clear it
+
+    ADMUX = (1 << REFS0) | Board::CV_IN_CHANNEL; // AVcc reference
+    ADCSRA = (savedControl & ~ADC_PRESCALER_MASK) | ADC_PRESCALER_32 | (1 << ADSC);
+    while (ADCSRA & (1 << ADSC))
+    {
+    }
+    int value = ADC;
+
+    ADMUX = savedMux;
+    ADCSRA = savedControl;
+    return value;
+}
+
+void CvInput::handleTrigger()
+{
+    bool level = Board::TriggerPin::read();
+    bool rising = level && !triggerLevel;
+    triggerLevel = level;
+    if (rising && mode == CV_IN_TRIGGER)
+    {
+        Board::CvPwm::write((uint16_t)((sampleSemitones() * compareStep) >> 16));
+    }
+}
+
+ISR(TRIGGER_PCINT_vect)
+{
+    CvInput::handleTrigger();
+}
+
+#else
+
+// Host builds read the simulated ADC, the trigger interrupt is not simulated
+void CvInput::begin()
+{
+    Board::TriggerPin::input();
+}
+
+int CvInput::guardedAnalogRead(uint8_t pin)
+{
+    return analogRead(pin);
+}
+
+int CvInput::readAdc()
+{
+    return analogRead(Board::CV_IN_CHANNEL);
+}
+
+#endif // __AVR__
+
+void CvInput::setMode(CvInputMode newMode)
+{
+    if (newMode < NUM_CV_INPUT_MODES)
+    {
+        mode = newMode;
+    }
+}
+
+uint8_t CvInput::readSemitones()
+{
+    // Number of thresholds at or below the reading, by binary search
+    int value = readAdc();
+    uint8_t low = 0;
+    uint8_t high = SEMITONES;
+    while (low < high)
+    {
+        uint8_t middle = (low + high) / 2;
+        if ((int)pgm_read_word(&semitoneThresholds[middle]) <= value)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+uint8_t CvInput::sampleSemitones()
+{
+    // The root (0V) is in every scale, so the result stays within 0 to SEMITONES
+    return quantizeToScale(readSemitones(), 0, scale);
+}
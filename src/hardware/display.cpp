@@ -1,16 +1,52 @@
 #include "hardware/display.h"
+#include "hardware/twi.h"
 
-Display::Display() : u8g2(U8G2_R0, /* reset=*/U8X8_PIN_NONE), initialized(false)
+U8G2_SSD1306_128X64_NONAME_1_TWI_ASYNC::U8G2_SSD1306_128X64_NONAME_1_TWI_ASYNC(const u8g2_cb_t *rotation) : U8G2()
 {
+    u8g2_Setup_ssd1306_i2c_128x64_noname_1(&u8g2, rotation, u8x8_byte_twi_async, u8x8_gpio_and_delay_arduino);
 }
 
-void Display::setup(unsigned long i2cSpeed)
+static_assert(Display::PAGE_QUEUE_BYTES < TWI_TX_BUFFER_SIZE, "A display page must fit the TWI queue");
+
+Display::Display() : u8g2(U8G2_R0), initialized(false), frameActive(false), powerOnPending(false)
+{
+}
+
+void Display::begin(unsigned long i2cSpeed)
 {
-    // Set I2C to specified speed (default 400kHz for optimal performance)
-    Wire.setClock(i2cSpeed);
-    u8g2.begin();
+    // Transfers are queued and sent from the TWI interrupt, the init sequence
+    // fits the empty queue, so the bus speed only affects how soon a frame is on screen
+    Twi::begin(i2cSpeed);
+    u8g2.initDisplay(); // Leaves the panel in power save
     initialized = true;
 
     // Set default font
     u8g2.setFont(u8g2_font_6x10_tf);
 }
+
+void Display::powerOn()
+{
+    powerOnPending = true; // Sent behind a complete frame, the panel never shows a partial one
+}
+
+void Display::beginFrame()
+{
+    u8g2.firstPage();
+    frameActive = true;
+}
+
+bool Display::canQueuePage()
+{
+    return Twi::getFree() >= PAGE_QUEUE_BYTES;
+}
+
+bool Display::queuePage()
+{
+    frameActive = u8g2.nextPage();
+    if (!frameActive && powerOnPending)
+    {
+        u8g2.setPowerSave(0);
+        powerOnPending = false;
+    }
+    return frameActive;
+}
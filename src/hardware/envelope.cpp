@@ -0,0 +1,93 @@
+#include "hardware/envelope.h"
+
+#ifdef ENABLE_ENVELOPE
+
+#include <util/atomic.h>
+
+// (1 - e^(-4x)) normalised to 0-255, the fraction of a segment's way covered at phase x
+const uint8_t envelopeCurve[256] PROGMEM = {
+    0, 4, 8, 12, 16, 20, 23, 27, 31, 34, 38, 41, 45, 48, 51, 54,
+    58, 61, 64, 67, 70, 73, 76, 79, 81, 84, 87, 90, 92, 95, 98, 100,
+    103, 105, 107, 110, 112, 114, 117, 119, 121, 123, 125, 127, 129, 132, 134, 135,
+    137, 139, 141, 143, 145, 147, 148, 150, 152, 154, 155, 157, 158, 160, 162, 163,
+    165, 166, 168, 169, 170, 172, 173, 174, 176, 177, 178, 180, 181, 182, 183, 185,
+    186, 187, 188, 189, 190, 191, 192, 193, 194, 195, 196, 197, 198, 199, 200, 201,
+    202, 203, 204, 205, 206, 206, 207, 208, 209, 210, 211, 211, 212, 213, 213, 214,
+    215, 216, 216, 217, 218, 218, 219, 220, 220, 221, 221, 222, 223, 223, 224, 224,
+    225, 225, 226, 226, 227, 228, 228, 229, 229, 229, 230, 230, 231, 231, 232, 232,
+    233, 233, 233, 234, 234, 235, 235, 235, 236, 236, 237, 237, 237, 238, 238, 238,
+    239, 239, 239, 240, 240, 240, 241, 241, 241, 241, 242, 242, 242, 243, 243, 243,
+    243, 244, 244, 244, 244, 245, 245, 245, 245, 245, 246, 246, 246, 246, 247, 247,
+    247, 247, 247, 248, 248, 248, 248, 248, 248, 249, 249, 249, 249, 249, 249, 250,
+    250, 250, 250, 250, 250, 251, 251, 251, 251, 251, 251, 251, 252, 252, 252, 252,
+    252, 252, 252, 252, 252, 253, 253, 253, 253, 253, 253, 253, 253, 253, 254, 254,
+    254, 254, 254, 254, 254, 254, 254, 254, 254, 255, 255, 255, 255, 255, 255, 255};
+
+EnvelopeMode Envelope::mode = ENVELOPE_ADSR;
+uint8_t Envelope::attackShare = 4;   // 1/16 of the gate
+uint8_t Envelope::decayShare = 16;   // 1/4 of the gate
+uint8_t Envelope::sustainLevel = 160;
+uint8_t Envelope::releaseShare = 32; // 1/2 of the gate
+
+volatile uint8_t Envelope::segment = SEGMENT_IDLE;
+volatile uint8_t Envelope::level = 0;
+uint8_t Envelope::startLevel = 0;
+uint8_t Envelope::targetLevel = 0;
+uint16_t Envelope::phase = 0;
+uint16_t Envelope::increment = 0;
+uint16_t Envelope::decayIncrement = 0;
+uint16_t Envelope::releaseIncrement = 0;
+__uint24 Envelope::gateTicks = 0;
+
+void Envelope::begin()
+{
+    Board::EnvelopePin::output();
+    OCR2B = 0;
+    TCCR2A |= 1 << COM2B1; // Non-inverting PWM on OC2B
+    Timer2::begin();
+}
+
+void Envelope::setShape(EnvelopeMode newMode, uint8_t attack, uint8_t decay, uint8_t sustain, uint8_t release)
+{
+    if (newMode >= NUM_ENVELOPE_MODES)
+    {
+        return;
+    }
+    // Applies from the next trigger, the running segment keeps its increment
+    mode = newMode;
+    attackShare = attack;
+    decayShare = decay;
+    sustainLevel = sustain;
+    releaseShare = release;
+}
+
+// Segments are capped at 65535 ticks, about 2 s
+uint16_t Envelope::segmentIncrement(uint32_t gate, uint8_t share)
+{
+    uint32_t ticks = (gate * share) >> 6;
+    if (ticks < 1)
+    {
+        ticks = 1;
+    }
+    return ticks > 0xFFFF ? 1 : (uint16_t)(0xFFFFUL / ticks);
+}
+
+void Envelope::trigger(float gateSeconds)
+{
+    // Division happens here, once per step, never in the interrupt
+    uint32_t gate = (uint32_t)(gateSeconds * TIMER2_TICK_RATE);
+    gate = constrain(gate, 1UL, 0xFFFFFFUL);
+    uint16_t attackIncrement = segmentIncrement(gate, attackShare);
+    uint16_t newDecayIncrement = segmentIncrement(gate, decayShare);
+    uint16_t newReleaseIncrement = segmentIncrement(gate, releaseShare);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        decayIncrement = newDecayIncrement;
+        releaseIncrement = newReleaseIncrement;
+        gateTicks = gate;
+        startSegment(SEGMENT_ATTACK, 255, attackIncrement);
+    }
+}
+
+#endif // ENABLE_ENVELOPE
@@ -1,56 +1,68 @@
 #include "hardware/pot.h"
+#include "hardware/cv_input.h"
+#include "profiler.h"
+#include "input_trace.h"
 
-Pot::Pot(int analogPin, float intervalSeconds, int smoothingSamples)
-    : pin(analogPin), lastRawValue(0), lastCheckedValue(0), lastMappedValue(0.0f), time(0),
-      readInterval(intervalSeconds), smoothingWindow(smoothingSamples), readIndex(0),
-      total(0), useSmoothing(smoothingSamples > 1)
-{
-    if (useSmoothing)
-    {
-        readings = new int[smoothingWindow];
-        for (int i = 0; i < smoothingWindow; i++)
-        {
-            readings[i] = 0;
-        }
-    }
-    else
-    {
-        readings = nullptr;
-    }
-}
+// Curve tables hold f(i / 32) * 1024 for i = 0..32, intermediate readings are
+// interpolated linearly between neighbouring entries
+static const uint8_t CURVE_INDEX_BITS = 5;
+static const uint8_t CURVE_POINTS = (1 << CURVE_INDEX_BITS) + 1;
+
+static const uint16_t curveTables[NUM_POT_CURVES - 1][CURVE_POINTS] PROGMEM = {
+    // POT_CURVE_LOG
+    {0, 1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121, 144, 169, 196, 225, 256,
+     289, 324, 361, 400, 441, 484, 529, 576, 625, 676, 729, 784, 841, 900, 961, 1024},
+    // POT_CURVE_EXP
+    {0, 2, 5, 8, 11, 15, 19, 24, 30, 36, 43, 52, 61, 72, 84, 98, 114,
+     132, 152, 176, 202, 233, 267, 307, 352, 403, 461, 527, 602, 688, 786, 897, 1024},
+    // POT_CURVE_S
+    {0, 3, 12, 25, 44, 67, 94, 126, 160, 197, 238, 280, 324, 370, 416, 464, 512,
+     560, 608, 654, 700, 744, 786, 827, 864, 898, 930, 957, 980, 999, 1012, 1021, 1024}};
 
-Pot::~Pot()
+Pot::Pot(int analogPin, float intervalSeconds, uint8_t restAlpha, uint8_t gain)
+    : pin(analogPin), lastRawValue(0), lastCheckedValue(0), time(0), readInterval(intervalSeconds),
+      filteredValue(0), speed(0), minAlpha(restAlpha), speedGain(gain), primed(false)
 {
-    if (readings != nullptr)
-    {
-        delete[] readings;
-    }
 }
 
 void Pot::update(float dt)
 {
+    PROFILE_SCOPE(PROFILE_POT_UPDATE);
+
     time += dt;
 
     if (time >= readInterval)
     {
-        int rawReading = analogRead(pin);
+        int rawReading = CvInput::guardedAnalogRead(pin); // The CV trigger interrupt also uses the ADC
+        TRACE_ANALOG(pin, rawReading);
+        int reading = rawReading << FILTER_FRACTION_BITS;
 
-        if (useSmoothing)
+        if (!primed)
         {
-            // Subtract the last reading
-            total = total - readings[readIndex];
-            // Read from the sensor
-            readings[readIndex] = rawReading;
-            // Add the reading to the total
-            total = total + readings[readIndex];
-            // Advance to the next position in the array
-            readIndex = (readIndex + 1) % smoothingWindow;
-            // Calculate the average
-            lastRawValue = total / smoothingWindow;
+            // Start from the first reading instead of sweeping up from zero
+            filteredValue = reading;
+            primed = true;
         }
         else
         {
-            lastRawValue = rawReading;
+            int delta = reading - filteredValue;
+
+            // Smooth the speed estimate so single noisy samples don't open the filter
+            unsigned int magnitude = delta < 0 ? -delta : delta;
+            speed = speed + ((int)(magnitude - speed) >> 2);
+
+            unsigned long alpha = minAlpha + (((unsigned long)speed * speedGain) >> 4);
+            if (alpha > 256)
+            {
+                alpha = 256;
+            }
+            filteredValue += (int)(((long)delta * (long)alpha) >> 8);
+        }
+
+        lastRawValue = (filteredValue + (1 << (FILTER_FRACTION_BITS - 1))) >> FILTER_FRACTION_BITS;
+        if (lastRawValue > MAX_VALUE)
+        {
+            lastRawValue = MAX_VALUE;
         }
 
         time = 0; // Reset the accumulator
@@ -62,17 +74,37 @@ int Pot::getRawValue()
     return lastRawValue;
 }
 
+int Pot::getCurvedValue(PotCurve curve)
+{
+    if (curve == POT_CURVE_LINEAR || curve >= NUM_POT_CURVES)
+    {
+        return lastRawValue;
+    }
+
+    const uint16_t *table = curveTables[curve - 1];
+    uint8_t index = lastRawValue >> CURVE_INDEX_BITS;
+    uint8_t fraction = lastRawValue & ((1 << CURVE_INDEX_BITS) - 1);
+    int low = pgm_read_word(&table[index]);
+    int high = pgm_read_word(&table[index + 1]);
+    int value = low + (((high - low) * fraction) >> CURVE_INDEX_BITS);
+    return value > MAX_VALUE ? MAX_VALUE : value;
+}
+
 float Pot::getLinearValue(float minValue, float maxValue)
 {
     float normalizedValue = (float)lastRawValue / 1023.0;
     return minValue + normalizedValue * (maxValue - minValue);
 }
 
-float Pot::getLogValue(float minValue, float maxValue, float curve)
+float Pot::getLogValue(float minValue, float maxValue)
 {
-    float normalizedValue = (float)lastRawValue / 1023.0;
-    float logValue = pow(normalizedValue, curve);
-    return minValue + logValue * (maxValue - minValue);
+    return getCurveValue(POT_CURVE_LOG, minValue, maxValue);
+}
+
+float Pot::getCurveValue(PotCurve curve, float minValue, float maxValue)
+{
+    float normalizedValue = (float)getCurvedValue(curve) / 1023.0;
+    return minValue + normalizedValue * (maxValue - minValue);
 }
 
 bool Pot::hasChanged(int threshold)
@@ -0,0 +1,27 @@
+#include "hardware/timer2.h"
+
+#if defined(ENABLE_AUDIO_VOICE) || defined(ENABLE_ENVELOPE)
+
+#include <avr/interrupt.h>
+#include "hardware/audio_voice.h"
+#include "hardware/envelope.h"
+
+void Timer2::begin()
+{
+    // Phase correct 8-bit PWM, no prescaler, overflow interrupt at BOTTOM; the outputs add their COM bits
+    TCCR2A |= 1 << WGM20;
+    TCCR2B = 1 << CS20;
+    TIMSK2 = 1 << TOIE2;
+}
+
+ISR(TIMER2_OVF_vect)
+{
+#ifdef ENABLE_AUDIO_VOICE
+    AudioVoice::handleInterrupt();
+#endif
+#ifdef ENABLE_ENVELOPE
+    Envelope::handleInterrupt();
+#endif
+}
+
+#endif // ENABLE_AUDIO_VOICE || ENABLE_ENVELOPE
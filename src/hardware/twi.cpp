@@ -0,0 +1,188 @@
+#include <avr/interrupt.h>
+#include "hardware/twi.h"
+#include "hal/board.h"
+
+// TWI status codes for master transmitter mode
+#define TWI_START 0x08
+#define TWI_REP_START 0x10
+#define TWI_MT_SLA_ACK 0x18
+#define TWI_MT_DATA_ACK 0x28
+
+uint8_t Twi::buffer[TWI_TX_BUFFER_SIZE];
+volatile uint8_t Twi::head = 0;
+volatile uint8_t Twi::tail = 0;
+uint8_t Twi::writeHead = 0;
+uint8_t Twi::lengthIndex = 0;
+uint8_t Twi::pendingLength = 0;
+volatile uint8_t Twi::remaining = 0;
+volatile bool Twi::busy = false;
+
+void Twi::begin(unsigned long clockHz)
+{
+    // Internal pull-ups on SDA and SCL, as Wire does
+    Board::TwiSda::inputPullup();
+    Board::TwiScl::inputPullup();
+    setClock(clockHz);
+    TWCR = (1 << TWEN);
+}
+
+void Twi::setClock(unsigned long clockHz)
+{
+    // SCL = F_CPU / (16 + 2 * TWBR) with a prescaler of 1
+    TWSR = 0;
+    unsigned long twbr = ((F_CPU / clockHz) - 16) / 2;
+    TWBR = twbr > 255 ? 255 : twbr;
+}
+
+void Twi::put(uint8_t data)
+{
+    // Only waits when the ring is full, the ISR frees space as it sends
+    while (((writeHead + 1) & MASK) == tail)
+    {
+    }
+    buffer[writeHead] = data;
+    writeHead = (writeHead + 1) & MASK;
+}
+
+void Twi::beginTransmission(uint8_t address)
+{
+    pendingLength = 0;
+    lengthIndex = writeHead;
+    put(0); // Length, filled in by endTransmission()
+    put(address & 0xFE);
+}
+
+void Twi::write(uint8_t data)
+{
+    put(data);
+    pendingLength++;
+}
+
+void Twi::endTransmission()
+{
+    buffer[lengthIndex] = pendingLength;
+
+    uint8_t oldSREG = SREG;
+    cli();
+    head = writeHead; // Publish the complete transfer to the ISR
+    if (!busy)
+    {
+        // The ISR may have just written STOP, a START before it is on the bus would be lost, as in Wire
+        while (TWCR & (1 << TWSTO))
+        {
+        }
+        busy = true;
+        startNext();
+    }
+    SREG = oldSREG;
+}
+
+bool Twi::isBusy()
+{
+    return busy;
+}
+
+uint8_t Twi::getFree()
+{
+    // One slot stays empty to tell a full ring from an empty one, tail is a single byte read
+    return (tail - writeHead - 1) & MASK;
+}
+
+void Twi::flush()
+{
+    while (busy || (TWCR & (1 << TWSTO))) // Including the final STOP
+    {
+    }
+}
+
+void Twi::startNext()
+{
+    // Header is [length][address], the address goes out once START has been sent
+    remaining = buffer[tail];
+    tail = (tail + 1) & MASK;
+    TWCR = (1 << TWEN) | (1 << TWIE) | (1 << TWINT) | (1 << TWSTA);
+}
+
+void Twi::handleInterrupt()
+{
+    switch (TWSR & 0xF8)
+    {
+    case TWI_START:
+    case TWI_REP_START:
+        TWDR = buffer[tail]; // Address
+        tail = (tail + 1) & MASK;
+        TWCR = (1 << TWEN) | (1 << TWIE) | (1 << TWINT);
+        break;
+
+    case TWI_MT_SLA_ACK:
+    case TWI_MT_DATA_ACK:
+        if (remaining > 0)
+        {
+            TWDR = buffer[tail];
+            tail = (tail + 1) & MASK;
+            remaining--;
+            TWCR = (1 << TWEN) | (1 << TWIE) | (1 << TWINT);
+        }
+        else if (tail != head)
+        {
+            startNext(); // Repeated start into the next queued transfer
+        }
+        else
+        {
+            TWCR = (1 << TWEN) | (1 << TWINT) | (1 << TWSTO);
+            busy = false;
+        }
+        break;
+
+    default:
+        // NACK, arbitration lost or bus error: drop the rest of this transfer
+        tail = (tail + remaining) & MASK;
+        remaining = 0;
+        if (tail != head)
+        {
+            // STOP followed by START for the next transfer
+            remaining = buffer[tail];
+            tail = (tail + 1) & MASK;
+            TWCR = (1 << TWEN) | (1 << TWIE) | (1 << TWINT) | (1 << TWSTO) | (1 << TWSTA);
+        }
+        else
+        {
+            TWCR = (1 << TWEN) | (1 << TWINT) | (1 << TWSTO);
+            busy = false;
+        }
+        break;
+    }
+}
+
+ISR(TWI_vect)
+{
+    Twi::handleInterrupt();
+}
+
+extern "C" uint8_t u8x8_byte_twi_async(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
+{
+    switch (msg)
+    {
+    case U8X8_MSG_BYTE_SEND:
+    {
+        uint8_t *data = (uint8_t *)arg_ptr;
+        while (arg_int-- > 0)
+        {
+            Twi::write(*data++);
+        }
+        break;
+    }
+    case U8X8_MSG_BYTE_INIT:
+    case U8X8_MSG_BYTE_SET_DC:
+        break; // Clock is configured by Display::setup(), there is no DC line on I2C
+    case U8X8_MSG_BYTE_START_TRANSFER:
+        Twi::beginTransmission(u8x8_GetI2CAddress(u8x8));
+        break;
+    case U8X8_MSG_BYTE_END_TRANSFER:
+        Twi::endTransmission();
+        break;
+    default:
+        return 0;
+    }
+    return 1;
+}
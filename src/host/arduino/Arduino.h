@@ -0,0 +1,110 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/*
+ * Minimal Arduino API for host builds (env:native)
+ *
+ * Only what the sequencer core uses is provided. Time is simulated: micros()
+ * and millis() return a clock that only moves when hostAdvanceMicros() is
+ * called, which keeps host runs deterministic.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define PROGMEM
+#define PSTR(string_literal) (string_literal)
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define pgm_read_ptr(address) (*(void *const *)(address))
+#define strcpy_P strcpy
+#define memcpy_P memcpy
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define DEC 10
+#define HEX 16
+
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// Time
+unsigned long micros();
+unsigned long millis();
+void hostAdvanceMicros(unsigned long us);
+
+// I/O, recorded per pin so host tools can inspect outputs
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void hostSetDigitalInput(uint8_t pin, uint8_t value);
+void hostSetAnalogInput(uint8_t pin, int value);
+typedef void (*HostPinWriteHook)(uint8_t pin, uint8_t value);
+void hostOnDigitalWrite(HostPinWriteHook hook); // Called on every digitalWrite(), e.g. to log outputs
+
+// Math
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    virtual void flush() {}
+    size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+
+    size_t print(const __FlashStringHelper *str) { return write((const char *)str); }
+    size_t print(const char *str) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return print('\n'); }
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual int availableForWrite() { return 0; }
+};
+
+// Serial port of host builds of the firmware: output is discarded, nothing is received
+class HostSerial : public Stream
+{
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    int availableForWrite() override { return 63; }
+    size_t write(uint8_t c) override { (void)c; return 1; }
+    using Print::write;
+};
+
+extern HostSerial Serial;
+
+#endif // HOST_ARDUINO_H
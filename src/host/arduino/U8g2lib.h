@@ -0,0 +1,40 @@
+#ifndef HOST_U8G2LIB_H
+#define HOST_U8G2LIB_H
+
+/*
+ * Headless U8g2 for host builds of the firmware (env:replay)
+ *
+ * Provides the drawing calls the UI uses as no-ops over a single page, so
+ * main.cpp compiles and runs unchanged without a display.
+ */
+
+#include <Arduino.h>
+
+struct u8g2_cb_t
+{
+};
+static const u8g2_cb_t u8g2_cb_r0 = {};
+#define U8G2_R0 (&u8g2_cb_r0)
+
+static const uint8_t u8g2_font_6x10_tf[1] = {0};
+
+class U8G2
+{
+public:
+    bool begin() { return true; }
+    void initDisplay() {}
+    void setPowerSave(uint8_t enable) { (void)enable; }
+    void setFont(const uint8_t *font) { (void)font; }
+    void firstPage() {}
+    uint8_t nextPage() { return 0; }
+    uint8_t getBufferCurrTileRow() { return 0; }
+    uint8_t getBufferTileHeight() { return 8; }
+    void drawStr(int x, int y, const char *text) { (void)x; (void)y; (void)text; }
+    void drawBox(int x, int y, int w, int h) { (void)x; (void)y; (void)w; (void)h; }
+    void drawFrame(int x, int y, int w, int h) { (void)x; (void)y; (void)w; (void)h; }
+    void drawHLine(int x, int y, int w) { (void)x; (void)y; (void)w; }
+    void drawVLine(int x, int y, int h) { (void)x; (void)y; (void)h; }
+    void drawPixel(int x, int y) { (void)x; (void)y; }
+};
+
+#endif // HOST_U8G2LIB_H
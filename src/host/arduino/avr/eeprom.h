@@ -0,0 +1,15 @@
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+// EEPROM for host builds, backed by RAM and always ready
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define E2END 0x3FF
+
+uint8_t eeprom_read_byte(const uint8_t *address);
+void eeprom_update_byte(uint8_t *address, uint8_t value);
+#define eeprom_is_ready() 1
+
+#endif // HOST_AVR_EEPROM_H
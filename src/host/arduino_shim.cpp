@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <stdio.h>
+
+static unsigned long hostMicros = 0;
+static uint8_t digitalPins[32];
+static int analogPins[8];
+static uint8_t eepromData[E2END + 1];
+static HostPinWriteHook pinWriteHook = nullptr;
+
+HostSerial Serial;
+
+unsigned long micros()
+{
+    return hostMicros;
+}
+
+unsigned long millis()
+{
+    return hostMicros / 1000;
+}
+
+void hostAdvanceMicros(unsigned long us)
+{
+    hostMicros += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < sizeof(digitalPins) && mode == INPUT_PULLUP)
+    {
+        digitalPins[pin] = HIGH;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin < sizeof(digitalPins))
+    {
+        digitalPins[pin] = value;
+    }
+    if (pinWriteHook != nullptr)
+    {
+        pinWriteHook(pin, value);
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return pin < sizeof(digitalPins) ? digitalPins[pin] : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+    return pin < 8 ? analogPins[pin] : 0;
+}
+
+void hostSetDigitalInput(uint8_t pin, uint8_t value)
+{
+    if (pin < sizeof(digitalPins))
+    {
+        digitalPins[pin] = value;
+    }
+}
+
+void hostOnDigitalWrite(HostPinWriteHook hook)
+{
+    pinWriteHook = hook;
+}
+
+void hostSetAnalogInput(uint8_t pin, int value)
+{
+    if (pin < 8)
+    {
+        analogPins[pin] = value;
+    }
+}
+
+long random(long max)
+{
+    return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max)
+{
+    return max > min ? min + rand() % (max - min) : min;
+}
+
+void randomSeed(unsigned long seed)
+{
+    srand(seed);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+    if (inMax == inMin)
+    {
+        return outMin;
+    }
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        write(buffer[i]);
+    }
+    return size;
+}
+
+size_t Print::print(long value, int base)
+{
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%ld", value);
+    return write(text);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%lu", value);
+    return write(text);
+}
+
+size_t Print::print(double value, int digits)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return write(text);
+}
+
+uint8_t eeprom_read_byte(const uint8_t *address)
+{
+    size_t index = (size_t)address;
+    return index <= E2END ? eepromData[index] : 0xFF;
+}
+
+void eeprom_update_byte(uint8_t *address, uint8_t value)
+{
+    size_t index = (size_t)address;
+    if (index <= E2END)
+    {
+        eepromData[index] = value;
+    }
+}
+
+struct EepromEraser
+{
+    EepromEraser() { memset(eepromData, 0xFF, sizeof(eepromData)); } // Erased like a fresh chip
+};
+static EepromEraser eepromEraser;
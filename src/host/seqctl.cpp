@@ -0,0 +1,421 @@
+/*
+ * seqctl - host side client for the serial pattern protocol
+ *
+ * Runs the sequencer core against a simulated serial port so the protocol can
+ * be exercised without hardware. Commands are taken from the arguments (one
+ * per argument) or, without arguments, line by line from stdin:
+ *
+ *   ping | telemetry | profile | memory
+ *   get <step> | set <step> <note> [gate 0-255] | changes <revision>
+ *   download | upload <note[:gate]>...
+ *   start | stop | reset | bpm <value>
+ *   clock <resolution 0-9> <division> <multiplication> <beats> <unit>
+ *   save <slot> | cue <slot> | song <pattern:repeats>... | song-start | song-stop
+ *   voice <waveform 0-3>   saw, square, triangle, sine (needs ENABLE_AUDIO_VOICE)
+ *   cvin <mode 0-2>        CV input off, sampled per step, sampled on the trigger input
+ *   envelope <mode 0-1> <attack> <decay> <sustain 0-255> <release>   ADSR or AD, times in 1/64 gate
+ *                          (needs ENABLE_ENVELOPE)
+ *   direction <0-4> [stride] [rotation]   forward, reverse, pendulum, random walk, stride
+ *   sync [role 0-2]        off, master, follower, prints the follower's lock state
+ *                          (the simulated sync port is unconnected, see seqsync for two units)
+ *   arp <mode 0-5> [octaves 1-4]   off, up, down, up-down, as played, random
+ *   hold <note>... | release <note>... | release all   held notes for the arpeggiator,
+ *                          run prints the notes it plays
+ *   zoom <0-3>             display window of 16, 32, 64 or 128 steps
+ *   run <ms>    advance the simulated clock with the player running
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sstream>
+#include <vector>
+#include "sequence.h"
+#include "sequence_player.h"
+#include "serial_protocol.h"
+#include "pattern_store.h"
+#include "song.h"
+#include "arpeggiator.h"
+#include "hardware/cv_input.h"
+#include "sync_link.h"
+#include "sim_serial.h"
+
+static const unsigned long TICK_MICROS = 1000; // Simulated loop() period
+static const int REPLY_TIMEOUT_TICKS = 1000;
+static const int BUSY_RETRIES = 100; // Requests sent again while the device answers STATUS_BUSY
+
+// The simulated unit: the same objects main.cpp wires together
+struct SimDevice
+{
+    Sequence sequence;
+    Sequence backSequence;
+    SequencePlayer player;
+    PatternStore store;
+    Song song;
+    SimSerial port;
+    SerialProtocol protocol;
+    SimSerial syncPort;
+    SyncLink syncLink;
+    Arpeggiator arpeggiator;
+
+    SimDevice()
+        : sequence(16), backSequence(16), player(&sequence, 120.0f), store(16),
+          song(&store, &player, &sequence, &backSequence), protocol(port, &player, &song), syncLink(syncPort, &player)
+    {
+        protocol.setSyncLink(&syncLink);
+        protocol.setArpeggiator(&arpeggiator);
+    }
+
+    void tick()
+    {
+        hostAdvanceMicros(TICK_MICROS);
+        player.updateMicros(TICK_MICROS);
+        syncLink.poll(micros());
+        protocol.poll();
+        song.update();
+    }
+};
+
+static SimDevice device;
+
+// Stands in for the step bus of main.cpp, only the arpeggiator's notes are of interest here
+void publishStepEvent(const StepEvent &event)
+{
+    if (!device.arpeggiator.isActive())
+        return;
+    int note = device.arpeggiator.nextNote();
+    if (note < 0)
+        printf("step %2d  -\n", event.step);
+    else
+        printf("step %2d  %d\n", event.step, note);
+}
+static SimSerial hostPort;
+static uint8_t replyBuffer[PROTOCOL_MAX_FRAME + 32];
+static CobsDecoder replyDecoder(replyBuffer, sizeof(replyBuffer));
+
+// Send one request and wait for its reply, text frames are printed as they arrive
+static bool request(const std::vector<uint8_t> &body, std::vector<uint8_t> &reply)
+{
+    uint8_t raw[PROTOCOL_MAX_FRAME];
+    uint8_t encoded[PROTOCOL_MAX_ENCODED];
+    uint8_t length = (uint8_t)body.size();
+
+    memcpy(raw, body.data(), length);
+    uint16_t crc = crc16(raw, length);
+    raw[length++] = crc >> 8;
+    raw[length++] = crc & 0xFF;
+    hostPort.write(encoded, cobsEncode(raw, length, encoded));
+
+    for (int tick = 0; tick < REPLY_TIMEOUT_TICKS; tick++)
+    {
+        device.tick();
+        while (hostPort.available() > 0)
+        {
+            if (!replyDecoder.feed(hostPort.read()))
+                continue;
+
+            uint8_t frameLength = replyDecoder.getLength();
+            replyDecoder.reset();
+            if (frameLength < 3 ||
+                crc16(replyBuffer, frameLength - 2) !=
+                    (uint16_t)((replyBuffer[frameLength - 2] << 8) | replyBuffer[frameLength - 1]))
+            {
+                printf("! corrupt reply\n");
+                continue;
+            }
+            if (replyBuffer[0] == FRAME_TEXT)
+            {
+                fwrite(replyBuffer + 1, 1, frameLength - 3, stdout);
+                continue;
+            }
+            reply.assign(replyBuffer, replyBuffer + frameLength - 2);
+            return true;
+        }
+    }
+    printf("! timeout\n");
+    return false;
+}
+
+static bool expectOk(const std::vector<uint8_t> &reply)
+{
+    if (reply.size() < 2 || reply[1] != STATUS_OK)
+    {
+        printf("! status %d\n", reply.size() >= 2 ? reply[1] : -1);
+        return false;
+    }
+    return true;
+}
+
+static void runCommand(const std::string &line)
+{
+    std::istringstream in(line);
+    std::string name;
+    if (!(in >> name))
+        return;
+
+    std::vector<uint8_t> reply;
+
+    if (name == "ping")
+    {
+        if (request({CMD_PING}, reply) && expectOk(reply))
+            printf("version %d\n", reply[2]);
+    }
+    else if (name == "get")
+    {
+        int step = 0;
+        in >> step;
+        if (request({CMD_GET_STEP, (uint8_t)step}, reply) && expectOk(reply))
+            printf("step %d note %d gate %d\n", reply[2], reply[3], reply[4]);
+    }
+    else if (name == "set")
+    {
+        int step = 0, note = 0, gate = 128;
+        in >> step >> note >> gate;
+        if (request({CMD_SET_STEP, (uint8_t)step, (uint8_t)note, (uint8_t)gate}, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "changes")
+    {
+        int revision = 0;
+        in >> revision;
+        // One request per 32 step page, the first reply gives the length
+        int length = 1;
+        for (int first = 0; first < length; first += 32)
+        {
+            if (!request({CMD_GET_CHANGES, (uint8_t)(revision >> 8), (uint8_t)(revision & 0xFF), (uint8_t)first}, reply) ||
+                !expectOk(reply))
+                return;
+            uint32_t changed = ((uint32_t)reply[5] << 24) | ((uint32_t)reply[6] << 16) | (reply[7] << 8) | reply[8];
+            if (first == 0)
+            {
+                length = reply[4];
+                printf("revision %d length %d changed", (reply[2] << 8) | reply[3], length);
+            }
+            for (int i = 0; i < 32; i++)
+                if (changed & (1UL << i))
+                    printf(" %d", first + i);
+        }
+        printf("\n");
+    }
+    else if (name == "download")
+    {
+        if (!request({CMD_GET_TELEMETRY}, reply) || !expectOk(reply))
+            return;
+        int length = reply[4];
+        for (int offset = 0; offset < length; offset += PROTOCOL_MAX_CHUNK_STEPS)
+        {
+            int count = length - offset < PROTOCOL_MAX_CHUNK_STEPS ? length - offset : PROTOCOL_MAX_CHUNK_STEPS;
+            if (!request({CMD_GET_PATTERN, (uint8_t)offset, (uint8_t)count}, reply) || !expectOk(reply))
+                return;
+            for (int i = 0; i < count; i++)
+                printf("%d:%d%c", reply[5 + i * 2], reply[6 + i * 2], offset + i == length - 1 ? '\n' : ' ');
+        }
+    }
+    else if (name == "upload")
+    {
+        std::vector<uint8_t> steps;
+        std::string token;
+        while (in >> token)
+        {
+            int note = 0, gate = 128;
+            sscanf(token.c_str(), "%d:%d", &note, &gate);
+            steps.push_back((uint8_t)note);
+            steps.push_back((uint8_t)gate);
+        }
+        int length = (int)steps.size() / 2;
+        for (int offset = 0; offset < length; offset += PROTOCOL_MAX_CHUNK_STEPS)
+        {
+            int count = length - offset < PROTOCOL_MAX_CHUNK_STEPS ? length - offset : PROTOCOL_MAX_CHUNK_STEPS;
+            std::vector<uint8_t> body = {CMD_SET_PATTERN, (uint8_t)length, (uint8_t)offset, (uint8_t)count};
+            body.insert(body.end(), steps.begin() + offset * 2, steps.begin() + (offset + count) * 2);
+            // A song load or save holds the back buffer for a moment, the chunk is sent again
+            bool sent = request(body, reply);
+            for (int retry = 0; sent && reply.size() >= 2 && reply[1] == STATUS_BUSY && retry < BUSY_RETRIES; retry++)
+                sent = request(body, reply);
+            if (!sent || !expectOk(reply))
+                return;
+        }
+        printf("uploaded %d steps\n", length);
+    }
+    else if (name == "start" || name == "stop" || name == "reset")
+    {
+        uint8_t action = name == "start" ? TRANSPORT_START : name == "stop" ? TRANSPORT_STOP : TRANSPORT_RESET;
+        if (request({CMD_TRANSPORT, action}, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "bpm")
+    {
+        float bpm = 120.0f;
+        in >> bpm;
+        unsigned int bpm10 = (unsigned int)(bpm * 10.0f + 0.5f);
+        if (request({CMD_SET_BPM, (uint8_t)(bpm10 >> 8), (uint8_t)(bpm10 & 0xFF)}, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "clock")
+    {
+        int resolution = STEP_1_4, division = 1, multiplication = 1, beats = 4, unit = 4;
+        in >> resolution >> division >> multiplication >> beats >> unit;
+        if (request({CMD_SET_CLOCK, (uint8_t)resolution, (uint8_t)division, (uint8_t)multiplication, (uint8_t)beats,
+                     (uint8_t)unit},
+                    reply) &&
+            expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "telemetry")
+    {
+        if (request({CMD_GET_TELEMETRY}, reply) && expectOk(reply))
+            printf("playing %d song %d step %d length %d bpm %.1f\n", (reply[2] & TELEMETRY_PLAYING) ? 1 : 0,
+                   (reply[2] & TELEMETRY_SONG) ? 1 : 0, reply[3], reply[4], ((reply[5] << 8) | reply[6]) / 10.0f);
+    }
+    else if (name == "profile")
+    {
+        if (request({CMD_PROFILE}, reply))
+            expectOk(reply);
+    }
+    else if (name == "memory")
+    {
+        if (request({CMD_GET_MEMORY}, reply) && expectOk(reply))
+        {
+            unsigned int values[6];
+            for (int i = 0; i < 6; i++)
+                values[i] = (reply[2 + i * 2] << 8) | reply[3 + i * 2];
+            printf("static %u heap %u (peak %u) stack peak %u free %u (min %u)\n", values[0], values[1], values[2],
+                   values[3], values[4], values[5]);
+        }
+    }
+    else if (name == "save" || name == "cue")
+    {
+        int slot = 0;
+        in >> slot;
+        if (request({name == "save" ? CMD_SAVE_PATTERN : CMD_CUE_PATTERN, (uint8_t)slot}, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "song")
+    {
+        std::vector<uint8_t> body = {CMD_SET_SONG, 0};
+        std::string token;
+        while (in >> token)
+        {
+            int pattern = 0, repeats = 1;
+            sscanf(token.c_str(), "%d:%d", &pattern, &repeats);
+            body.push_back((uint8_t)pattern);
+            body.push_back((uint8_t)repeats);
+            body[1]++;
+        }
+        if (request(body, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "song-start" || name == "song-stop")
+    {
+        if (request({CMD_SONG, (uint8_t)(name == "song-start" ? 1 : 0)}, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "voice")
+    {
+        int waveform = 0;
+        in >> waveform;
+        if (request({CMD_SET_VOICE, (uint8_t)waveform}, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "envelope")
+    {
+        int mode = 0, attack = 4, decay = 16, sustain = 160, release = 32;
+        in >> mode >> attack >> decay >> sustain >> release;
+        if (request({CMD_SET_ENVELOPE, (uint8_t)mode, (uint8_t)attack, (uint8_t)decay, (uint8_t)sustain,
+                     (uint8_t)release},
+                    reply) &&
+            expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "sync")
+    {
+        std::vector<uint8_t> body = {CMD_SYNC};
+        int role = 0;
+        if (in >> role)
+            body.push_back((uint8_t)role);
+        if (request(body, reply) && expectOk(reply))
+        {
+            static const char *const roles[] = {"off", "master", "follower"};
+            printf("%s %s phase %dus latency %uus skew %dppm\n", reply[2] < 3 ? roles[reply[2]] : "?",
+                   reply[3] ? "locked" : "unlocked", (int16_t)((reply[4] << 8) | reply[5]), (reply[6] << 8) | reply[7],
+                   (int16_t)((reply[8] << 8) | reply[9]));
+        }
+    }
+    else if (name == "arp")
+    {
+        int mode = ARP_OFF, octaves = 1;
+        in >> mode >> octaves;
+        if (request({CMD_SET_ARP, (uint8_t)mode, (uint8_t)octaves}, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "hold" || name == "release")
+    {
+        std::string note;
+        while (in >> note)
+        {
+            uint8_t value = note == "all" ? 0xFF : (uint8_t)atoi(note.c_str());
+            if (!request({CMD_ARP_NOTE, value, (uint8_t)(name == "hold" ? 1 : 0)}, reply) || !expectOk(reply))
+                return;
+        }
+        printf("ok\n");
+    }
+    else if (name == "zoom")
+    {
+        int zoom = 0;
+        in >> zoom;
+        if (request({CMD_SET_VIEW, (uint8_t)zoom}, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "cvin")
+    {
+        int mode = CV_IN_OFF;
+        in >> mode;
+        if (request({CMD_SET_CV_INPUT, (uint8_t)mode}, reply) && expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "direction")
+    {
+        int direction = PLAY_FORWARD, stride = 1, rotation = 0;
+        in >> direction >> stride >> rotation;
+        if (request({CMD_SET_DIRECTION, (uint8_t)direction, (uint8_t)stride, (uint8_t)rotation}, reply) &&
+            expectOk(reply))
+            printf("ok\n");
+    }
+    else if (name == "run")
+    {
+        int ms = 0;
+        in >> ms;
+        for (int i = 0; i < ms * 1000 / (int)TICK_MICROS; i++)
+            device.tick();
+        printf("t=%lums\n", millis());
+    }
+    else
+    {
+        printf("! unknown command '%s'\n", name.c_str());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    hostPort.connect(device.port);
+
+    int defaultNotes[] = {36, 38, 40, 41, 43, 45, 47, 48};
+    device.sequence.setNotes(defaultNotes, 8);
+
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+            runCommand(argv[i]);
+        return 0;
+    }
+
+    std::string line;
+    char buffer[512];
+    while (fgets(buffer, sizeof(buffer), stdin) != nullptr)
+    {
+        line = buffer;
+        runCommand(line);
+    }
+    return 0;
+}
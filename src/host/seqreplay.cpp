@@ -0,0 +1,371 @@
+/*
+ * seqreplay - deterministic replay of recorded input traces
+ *
+ * Builds the complete firmware (main.cpp with update() and the player) for the
+ * host and drives it with a trace captured by the input trace recorder (see
+ * include/input_trace.h). Every recorded loop() time step and every button and
+ * pot reading is fed back in order, so the same trace always produces the same
+ * output, which makes behaviour and timing diffable across firmware versions.
+ *
+ *   seqreplay [-s] <trace>                       replay and print gate/CV events
+ *   seqreplay capture <port> <trace> <seconds>  record a trace from a unit (115200 baud)
+ *
+ * -s prints only the summary. Captures start right after the reset that
+ * opening the port causes, so replays begin from the same boot state. That
+ * includes the pattern the unit restored from EEPROM: the capture reads it
+ * before the trace starts, and the replay saves it as the last used slot of
+ * the simulated EEPROM before setup() runs.
+ *
+ * Trace files are "SQTR" followed by a version byte, then in version 2 the
+ * playing pattern as [length]([note][gate])*length, then the raw trace
+ * stream. Version 1 files have no pattern and replay with an erased EEPROM.
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "hal/board.h"
+#include "input_trace.h"
+#include "pattern_store.h"
+#include "serial_protocol.h"
+#include "sim_hardware.h"
+
+void setup();
+void loop();
+extern PatternStore patternStore;
+
+static const char TRACE_MAGIC[4] = {'S', 'Q', 'T', 'R'};
+static const uint8_t TRACE_FILE_VERSION = 2;
+static const uint8_t TRACE_FILE_VERSION_NO_PATTERN = 1;
+
+// Outputs observed by the replay, as wired by the host board traits
+static const uint8_t GATE_PIN = Board::GATE_PIN;
+static const uint8_t CV_PIN = Board::CvPwm::PIN;
+static const float CV_MAX_VOLTAGE = 5.0f;
+
+static bool quiet = false;
+static unsigned long gateCount = 0;
+static unsigned long lastGateOn = 0;
+static unsigned long minStepInterval = 0xFFFFFFFFUL;
+static unsigned long maxStepInterval = 0;
+static unsigned long long stepIntervalSum = 0;
+static uint8_t gateLevel = LOW;
+
+static void onDigitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin != GATE_PIN || value == gateLevel)
+        return;
+    gateLevel = value;
+
+    unsigned long now = micros();
+    if (value == HIGH)
+    {
+        unsigned long interval = gateCount > 0 ? now - lastGateOn : 0;
+        if (gateCount > 0)
+        {
+            minStepInterval = interval < minStepInterval ? interval : minStepInterval;
+            maxStepInterval = interval > maxStepInterval ? interval : maxStepInterval;
+            stepIntervalSum += interval;
+        }
+        gateCount++;
+        lastGateOn = now;
+        if (!quiet)
+            printf("%10lu gate on  cv %.3fV interval %lu\n", now, hostGetPwmDutyCycle(CV_PIN) * CV_MAX_VOLTAGE,
+                   interval);
+    }
+    else if (!quiet)
+    {
+        printf("%10lu gate off\n", now);
+    }
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+    uint8_t chunk[256];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + count);
+    fclose(file);
+    return true;
+}
+
+// Saves the pattern the unit booted with as the last used slot, so setup() restores it as the unit did
+static void seedEeprom(const uint8_t *steps, uint8_t length)
+{
+    Sequence pattern(MAX_SEQUENCE_LENGTH);
+    for (uint8_t i = 0; i < length; i++)
+    {
+        pattern.setNote(i, steps[i * 2]);
+        pattern.setGateDuration(i, steps[i * 2 + 1] / 255.0f);
+    }
+    if (patternStore.beginSave(0, &pattern))
+    {
+        while (!patternStore.update())
+        {
+        }
+        patternStore.update(); // Writes the last used slot now that the save is done
+    }
+}
+
+static int replay(const char *path)
+{
+    std::vector<uint8_t> trace;
+    if (!readFile(path, trace) || trace.size() < 5 || memcmp(trace.data(), TRACE_MAGIC, 4) != 0 ||
+        (trace[4] != TRACE_FILE_VERSION && trace[4] != TRACE_FILE_VERSION_NO_PATTERN))
+    {
+        fprintf(stderr, "! %s is not a trace file\n", path);
+        return 1;
+    }
+
+    size_t i = 5;
+    if (trace[4] == TRACE_FILE_VERSION)
+    {
+        uint8_t length = i < trace.size() ? trace[i] : 0;
+        if (i + 1 + length * 2 > trace.size())
+        {
+            fprintf(stderr, "! %s has a truncated pattern\n", path);
+            return 1;
+        }
+        if (length > 0)
+            seedEeprom(&trace[i + 1], length);
+        i += 1 + length * 2;
+    }
+
+    hostOnDigitalWrite(onDigitalWrite);
+    setup();
+
+    unsigned long frames = 0;
+    unsigned long dropped = 0;
+    unsigned long long hostNanos = 0;
+    unsigned long long maxHostNanos = 0;
+    float lastCv = hostGetPwmDutyCycle(CV_PIN);
+    bool framePending = false;
+    unsigned long frameMicros = 0;
+
+    // A frame runs once all inputs recorded after its frame record are applied
+    while (true)
+    {
+        bool atEnd = i >= trace.size();
+        uint8_t tag = atEnd ? TRACE_FRAME : trace[i];
+
+        if ((tag & TRACE_TYPE_MASK) == TRACE_FRAME && framePending)
+        {
+            hostAdvanceMicros(frameMicros);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            loop();
+            unsigned long long nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                           std::chrono::steady_clock::now() - start)
+                                           .count();
+            hostNanos += nanos;
+            maxHostNanos = nanos > maxHostNanos ? nanos : maxHostNanos;
+            frames++;
+            framePending = false;
+
+            float cv = hostGetPwmDutyCycle(CV_PIN);
+            if (cv != lastCv && !quiet)
+                printf("%10lu cv %.3fV\n", micros(), cv * CV_MAX_VOLTAGE);
+            lastCv = cv;
+        }
+        if (atEnd)
+            break;
+
+        i++;
+        switch (tag & TRACE_TYPE_MASK)
+        {
+        case TRACE_FRAME:
+        {
+            frameMicros = 0;
+            uint8_t shift = 0;
+            while (i < trace.size())
+            {
+                uint8_t data = trace[i++];
+                frameMicros |= (unsigned long)(data & 0x7F) << shift;
+                shift += 7;
+                if (!(data & 0x80))
+                    break;
+            }
+            framePending = true;
+            break;
+        }
+        case TRACE_DIGITAL_LOW:
+        case TRACE_DIGITAL_HIGH:
+            hostSetDigitalInput(tag & 0x0F, (tag & TRACE_TYPE_MASK) == TRACE_DIGITAL_HIGH ? HIGH : LOW);
+            break;
+        case TRACE_ANALOG:
+            if (i + 2 > trace.size())
+            {
+                i = trace.size();
+                break;
+            }
+            hostSetAnalogInput(tag & 0x0F, trace[i] | (trace[i + 1] << 8));
+            i += 2;
+            break;
+        case TRACE_OVERFLOW:
+            dropped += i < trace.size() ? trace[i++] : 0;
+            break;
+        default:
+            fprintf(stderr, "! bad trace record 0x%02x at offset %u\n", tag, (unsigned int)(i - 1));
+            return 1;
+        }
+    }
+
+    printf("# frames %lu time %luus dropped events %lu\n", frames, micros(), dropped);
+    printf("# gates %lu", gateCount);
+    if (gateCount > 1)
+        printf(" step interval min %lu mean %llu max %lu", minStepInterval, stepIntervalSum / (gateCount - 1),
+               maxStepInterval);
+    printf("\n# host loop() ns mean %llu max %llu\n", frames > 0 ? hostNanos / frames : 0, maxHostNanos);
+    if (dropped > 0)
+        printf("# warning: the trace has gaps, the replay is not exact\n");
+    return 0;
+}
+
+static void sendRequest(int port, const uint8_t *body, uint8_t bodyLength)
+{
+    uint8_t raw[8];
+    uint8_t encoded[PROTOCOL_MAX_ENCODED];
+    memcpy(raw, body, bodyLength);
+    uint16_t crc = crc16(raw, bodyLength);
+    raw[bodyLength] = crc >> 8;
+    raw[bodyLength + 1] = crc & 0xFF;
+    uint8_t length = cobsEncode(raw, bodyLength + 2, encoded);
+    if (write(port, encoded, length) != length)
+        fprintf(stderr, "! write failed\n");
+}
+
+static void sendCommand(int port, uint8_t command, uint8_t argument)
+{
+    uint8_t body[2] = {command, argument};
+    sendRequest(port, body, sizeof(body));
+}
+
+static void requestPatternChunk(int port, uint8_t offset, uint8_t count)
+{
+    uint8_t body[3] = {CMD_GET_PATTERN, offset, count};
+    sendRequest(port, body, sizeof(body));
+}
+
+static int capture(const char *device, const char *path, int seconds)
+{
+    int port = open(device, O_RDWR | O_NOCTTY);
+    if (port < 0)
+    {
+        fprintf(stderr, "! cannot open %s\n", device);
+        return 1;
+    }
+    termios settings;
+    tcgetattr(port, &settings);
+    cfmakeraw(&settings);
+    cfsetispeed(&settings, B115200);
+    cfsetospeed(&settings, B115200);
+    settings.c_cc[VMIN] = 0;
+    settings.c_cc[VTIME] = 1; // Reads return after 100ms without data
+    tcsetattr(port, TCSANOW, &settings);
+
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "! cannot create %s\n", path);
+        close(port);
+        return 1;
+    }
+    fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), file);
+    fputc(TRACE_FILE_VERSION, file);
+
+    sleep(2); // Opening the port resets the unit, wait for the bootloader
+    tcflush(port, TCIFLUSH);
+    // The pattern the unit restored at boot comes first, the trace starts once it is complete
+    std::vector<uint8_t> pattern;
+    bool patternRead = false;
+    requestPatternChunk(port, 0, 1);
+
+    uint8_t frame[PROTOCOL_MAX_FRAME];
+    CobsDecoder decoder(frame, sizeof(frame));
+    unsigned long traceBytes = 0;
+    bool started = false;
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+        uint8_t input[64];
+        ssize_t count = read(port, input, sizeof(input));
+        for (ssize_t n = 0; n < count; n++)
+        {
+            if (!decoder.feed(input[n]))
+                continue;
+            uint8_t length = decoder.getLength();
+            decoder.reset();
+            if (length < 3 || crc16(frame, length - 2) != (uint16_t)((frame[length - 2] << 8) | frame[length - 1]))
+                continue;
+            if (frame[0] == (CMD_GET_PATTERN | RESPONSE_BIT) && !patternRead && length >= 7 && frame[1] == STATUS_OK)
+            {
+                // [status][length][offset][count]([note][gate])*count
+                uint8_t patternLength = frame[2];
+                uint8_t count = frame[4];
+                if (frame[3] == pattern.size() / 2 && length >= 7 + count * 2)
+                    pattern.insert(pattern.end(), frame + 5, frame + 5 + count * 2);
+                uint8_t next = pattern.size() / 2;
+                if (next < patternLength)
+                {
+                    uint8_t remaining = patternLength - next;
+                    requestPatternChunk(port, next, remaining < PROTOCOL_MAX_CHUNK_STEPS ? remaining : PROTOCOL_MAX_CHUNK_STEPS);
+                }
+                else
+                {
+                    patternRead = true;
+                    fputc(patternLength, file);
+                    fwrite(pattern.data(), 1, pattern.size(), file);
+                    sendCommand(port, CMD_TRACE, 1);
+                }
+            }
+            else if (frame[0] == (CMD_TRACE | RESPONSE_BIT))
+            {
+                started = frame[1] == STATUS_OK;
+                if (!started)
+                {
+                    fprintf(stderr, "! the firmware was built without -DENABLE_TRACE\n");
+                    end = std::chrono::steady_clock::now();
+                }
+            }
+            else if (frame[0] == FRAME_TRACE)
+            {
+                fwrite(frame + 1, 1, length - 3, file);
+                traceBytes += length - 3;
+            }
+        }
+    }
+
+    sendCommand(port, CMD_TRACE, 0);
+    fclose(file);
+    close(port);
+    if (!patternRead)
+        fprintf(stderr, "! the unit did not report its pattern\n");
+    printf("captured %lu bytes\n", traceBytes);
+    return started ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 5 && strcmp(argv[1], "capture") == 0)
+        return capture(argv[2], argv[3], atoi(argv[4]));
+
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "-s") == 0)
+    {
+        quiet = true;
+        first = 2;
+    }
+    if (argc != first + 1)
+    {
+        fprintf(stderr, "usage: seqreplay [-s] <trace> | seqreplay capture <port> <trace> <seconds>\n");
+        return 1;
+    }
+    return replay(argv[first]);
+}
@@ -0,0 +1,170 @@
+/*
+ * seqsync - master/follower clock sync between two simulated units
+ *
+ * Runs two sequencer cores connected by a simulated UART at SYNC_BAUD, with
+ * the bytes delayed by their wire time. The follower's crystal runs off by
+ * the given skew and both main loops have their own period and jitter, so
+ * the follower has to find the latency, the skew and the phase on its own:
+ *
+ *   seqsync [-o] [skew ppm] [seconds]
+ *
+ * -o leaves the follower's TX unconnected, so it cannot measure round trips.
+ * The master changes tempo, stops, restarts and resets along the way. Every
+ * half second one line shows the true phase error (measured by the
+ * simulation), and what the follower's SyncLink reports.
+ */
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sequence.h"
+#include "sequence_player.h"
+#include "sync_link.h"
+#include "sim_serial.h"
+
+static const unsigned long SIM_STEP_MICROS = 20; // Resolution of the simulated time
+static const unsigned long REPORT_MICROS = 500000;
+static const unsigned long SETTLE_MICROS = 3000000; // Lock-in time left out of the statistics
+
+// One unit: a player, its sync link and a main loop on its own crystal
+struct SimUnit
+{
+    Sequence sequence;
+    SequencePlayer player;
+    SimSerial port;
+    SyncLink link;
+
+    double clockRatio;         // Local microseconds per true microsecond
+    unsigned long loopMicros;  // Nominal loop period
+    unsigned long jitterMicros; // Random extra time per loop
+    unsigned long nextLoop;    // True time of the next loop() run
+    unsigned long localNow;    // Local micros() at the last loop() run
+    unsigned long lastLoop;    // True time of the last loop() run
+
+    SimUnit(double ratio, unsigned long period, unsigned long jitter)
+        : sequence(16), player(&sequence, 120.0f), link(port, &player), clockRatio(ratio), loopMicros(period),
+          jitterMicros(jitter), nextLoop(0), localNow(0), lastLoop(0)
+    {
+    }
+
+    void run(unsigned long trueMicros)
+    {
+        if ((long)(trueMicros - nextLoop) < 0)
+            return;
+        unsigned long now = (unsigned long)(trueMicros * clockRatio);
+        player.updateMicros(now - localNow);
+        link.poll(now);
+        localNow = now;
+        lastLoop = trueMicros;
+        nextLoop = trueMicros + loopMicros + (jitterMicros > 0 ? random(jitterMicros) : 0);
+    }
+
+    // Position in ticks at a true time after the last loop, as the player would see it
+    double position(unsigned long trueMicros)
+    {
+        double elapsed = (trueMicros - lastLoop) * clockRatio * 256.0;
+        return player.getMasterTick() + (player.getTickAccumulator() + elapsed) / player.getTickPeriod();
+    }
+};
+
+int main(int argc, char **argv)
+{
+    bool oneWay = false;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "-o") == 0)
+    {
+        oneWay = true;
+        first = 2;
+    }
+    double skewPpm = argc > first ? atof(argv[first]) : 300.0;
+    unsigned long seconds = argc > first + 1 ? strtoul(argv[first + 1], nullptr, 10) : 30;
+
+    SimUnit master(1.0, 1000, 400);
+    SimUnit follower(1.0 + skewPpm / 1000000.0, 1300, 700);
+    master.port.setBaud(SYNC_BAUD);
+    follower.port.setBaud(SYNC_BAUD);
+    master.port.connect(follower.port);
+    SimSerial unconnected;
+    if (oneWay)
+        follower.port.connect(unconnected); // The master still sends to the follower
+
+    int notes[] = {36, 38, 40, 41, 43, 45, 47, 48};
+    master.sequence.setNotes(notes, 8);
+    follower.sequence.setNotes(notes, 8);
+    follower.player.setBpm(97.0f); // Free-running at another tempo until the first clock frame
+    follower.player.start();
+    master.player.start();
+    master.link.setRole(SYNC_MASTER);
+    follower.link.setRole(SYNC_FOLLOWER);
+
+    // Master transport and tempo changes, in true seconds
+    const unsigned long endMicros = seconds * 1000000UL;
+    unsigned long nextReport = REPORT_MICROS;
+    double sumError = 0.0;
+    double maxError = 0.0;
+    unsigned long samples = 0;
+    unsigned long settleUntil = SETTLE_MICROS;
+    int event = 0;
+
+    printf("# skew %.0f ppm, %s link\n", skewPpm, oneWay ? "one-way" : "two-way");
+    printf("#    time  bpm master/follower   true error  reported error  latency  skew     lock\n");
+    for (unsigned long now = 0; now < endMicros; now += SIM_STEP_MICROS)
+    {
+        hostAdvanceMicros(SIM_STEP_MICROS);
+
+        const unsigned long seconds10 = now / 100000;
+        if (event == 0 && seconds10 >= 80)
+        {
+            master.player.setBpm(143.0f);
+            printf("# master tempo 143\n");
+            settleUntil = now + SETTLE_MICROS;
+            event++;
+        }
+        else if (event == 1 && seconds10 >= 150)
+        {
+            master.player.stop();
+            printf("# master stop\n");
+            event++;
+        }
+        else if (event == 2 && seconds10 >= 170)
+        {
+            master.player.start();
+            printf("# master start\n");
+            settleUntil = now + SETTLE_MICROS;
+            event++;
+        }
+        else if (event == 3 && seconds10 >= 220)
+        {
+            master.player.reset();
+            printf("# master reset\n");
+            settleUntil = now + SETTLE_MICROS;
+            event++;
+        }
+
+        master.run(now);
+        follower.run(now);
+
+        bool bothPlaying = master.player.getIsPlaying() && follower.player.getIsPlaying();
+        double error = bothPlaying ? (follower.position(now) - master.position(now)) * master.player.getTickPeriod() / 256.0 : 0.0;
+        if (bothPlaying && now >= settleUntil)
+        {
+            sumError += fabs(error);
+            maxError = fabs(error) > maxError ? fabs(error) : maxError;
+            samples++;
+        }
+
+        if (now >= nextReport)
+        {
+            nextReport += REPORT_MICROS;
+            printf("%9.1fs  %6.1f / %6.1f  %9.0fus  %12ldus  %6uus  %4ldppm  %s\n", now / 1000000.0,
+                   master.player.getBpm(), follower.player.getBpm(), error, follower.link.getPhaseError(),
+                   follower.link.getLatency(), follower.link.getSkewPpm(), follower.link.isLocked() ? "locked" : "-");
+        }
+    }
+
+    printf("# after lock-in: mean |error| %.0fus max %.0fus over %lu samples\n", samples > 0 ? sumError / samples : 0.0,
+           maxError, samples);
+    printf("# master step %d follower step %d\n", master.player.getCurrentStep(), follower.player.getCurrentStep());
+    return maxError <= 1000.0 ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+/*
+ * Host side of the hardware that touches AVR peripherals directly, used when
+ * main.cpp is built for the host (env:replay). Pins and the CV timer come
+ * from BoardHost in include/hal/board_host.h.
+ */
+
+#include "hal/board.h"
+#include "hardware/display.h"
+#include "sim_hardware.h"
+
+static float pwmDutyCycle[32];
+
+uint16_t BoardHost::CvPwm::top = 0;
+
+float hostGetPwmDutyCycle(int pin)
+{
+    return pin >= 0 && pin < 32 ? pwmDutyCycle[pin] : 0.0f;
+}
+
+void hostSetPwmDutyCycle(uint8_t pin, float dutyCycle)
+{
+    if (pin < 32)
+    {
+        pwmDutyCycle[pin] = constrain(dutyCycle, 0.0f, 1.0f);
+    }
+}
+
+U8G2_SSD1306_128X64_NONAME_1_TWI_ASYNC::U8G2_SSD1306_128X64_NONAME_1_TWI_ASYNC(const u8g2_cb_t *rotation) : U8G2()
+{
+    (void)rotation;
+}
+
+Display::Display() : u8g2(U8G2_R0), initialized(false), frameActive(false), powerOnPending(false)
+{
+}
+
+void Display::begin(unsigned long i2cSpeed)
+{
+    (void)i2cSpeed;
+    u8g2.initDisplay();
+    initialized = true;
+}
+
+void Display::powerOn()
+{
+    u8g2.setPowerSave(0);
+}
+
+void Display::beginFrame()
+{
+    u8g2.firstPage();
+    frameActive = true;
+}
+
+bool Display::canQueuePage()
+{
+    return true;
+}
+
+bool Display::queuePage()
+{
+    frameActive = u8g2.nextPage();
+    return frameActive;
+}
@@ -0,0 +1,7 @@
+#ifndef SIM_HARDWARE_H
+#define SIM_HARDWARE_H
+
+// Last duty cycle (0.0-1.0) set through PWM on a pin
+float hostGetPwmDutyCycle(int pin);
+
+#endif // SIM_HARDWARE_H
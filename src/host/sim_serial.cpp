@@ -0,0 +1,71 @@
+#include "sim_serial.h"
+
+SimSerial::SimSerial() : peer(nullptr), byteMicros(0), txFreeAt(0)
+{
+}
+
+void SimSerial::connect(SimSerial &other)
+{
+    peer = &other;
+    other.peer = this;
+}
+
+void SimSerial::setBaud(unsigned long baud)
+{
+    byteMicros = baud > 0 ? (10 * 1000000UL + baud / 2) / baud : 0; // Start, 8 data and stop bit
+}
+
+int SimSerial::available()
+{
+    // Bytes still on the wire are not visible yet
+    unsigned long now = micros();
+    int count = 0;
+    while (count < (int)rxTimes.size() && (long)(rxTimes[count] - now) <= 0)
+    {
+        count++;
+    }
+    return count;
+}
+
+int SimSerial::read()
+{
+    if (available() == 0)
+    {
+        return -1;
+    }
+    uint8_t c = rxQueue.front();
+    rxQueue.pop_front();
+    rxTimes.pop_front();
+    return c;
+}
+
+int SimSerial::peek()
+{
+    return available() == 0 ? -1 : rxQueue.front();
+}
+
+int SimSerial::availableForWrite()
+{
+    unsigned long now = micros();
+    if (byteMicros == 0 || (long)(txFreeAt - now) <= 0)
+    {
+        return TX_BUFFER_SIZE;
+    }
+    int queued = (int)((txFreeAt - now + byteMicros - 1) / byteMicros);
+    return queued < TX_BUFFER_SIZE ? TX_BUFFER_SIZE - queued : 0;
+}
+
+size_t SimSerial::write(uint8_t c)
+{
+    unsigned long now = micros();
+    if (byteMicros > 0)
+    {
+        txFreeAt = ((long)(txFreeAt - now) > 0 ? txFreeAt : now) + byteMicros;
+    }
+    if (peer != nullptr)
+    {
+        peer->rxQueue.push_back(c);
+        peer->rxTimes.push_back(byteMicros > 0 ? txFreeAt : now);
+    }
+    return 1;
+}
@@ -0,0 +1,32 @@
+#ifndef SIM_SERIAL_H
+#define SIM_SERIAL_H
+
+#include <Arduino.h>
+#include <deque>
+
+// One end of a simulated serial link, bytes written here arrive at the peer
+class SimSerial : public Stream
+{
+private:
+    static const int TX_BUFFER_SIZE = 63; // Same free space as the AVR HardwareSerial buffer
+
+    std::deque<uint8_t> rxQueue;
+    std::deque<unsigned long> rxTimes; // micros() at which each queued byte has arrived
+    SimSerial *peer;
+    unsigned long byteMicros; // Wire time per byte, 0 delivers at once
+    unsigned long txFreeAt;   // micros() at which the last written byte is on the wire
+
+public:
+    SimSerial();
+    void connect(SimSerial &other);
+    void setBaud(unsigned long baud); // Delays bytes by their wire time at 8N1, 0 for instant delivery
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite() override;
+    size_t write(uint8_t c) override;
+    using Print::write;
+};
+
+#endif // SIM_SERIAL_H
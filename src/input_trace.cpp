@@ -0,0 +1,125 @@
+#include "input_trace.h"
+
+#ifdef ENABLE_TRACE
+
+uint8_t InputTrace::buffer[TRACE_BUFFER_SIZE];
+uint8_t InputTrace::head = 0;
+uint8_t InputTrace::tail = 0;
+uint8_t InputTrace::dropped = 0;
+bool InputTrace::active = false;
+uint16_t InputTrace::digitalState = 0;
+uint16_t InputTrace::digitalKnown = 0;
+int InputTrace::analogState[TRACE_MAX_ANALOG_CHANNELS];
+
+void InputTrace::start()
+{
+    head = 0;
+    tail = 0;
+    dropped = 0;
+    digitalKnown = 0;
+    for (uint8_t i = 0; i < TRACE_MAX_ANALOG_CHANNELS; i++)
+    {
+        analogState[i] = -1;
+    }
+    active = true;
+}
+
+void InputTrace::stop()
+{
+    active = false;
+}
+
+uint8_t InputTrace::space()
+{
+    return (TRACE_BUFFER_SIZE - 1) - ((head - tail) & (TRACE_BUFFER_SIZE - 1));
+}
+
+void InputTrace::put(uint8_t data)
+{
+    buffer[head] = data;
+    head = (head + 1) & (TRACE_BUFFER_SIZE - 1);
+}
+
+bool InputTrace::reserve(uint8_t size)
+{
+    // Two bytes are always kept free so a pending overflow marker fits in front of the next event
+    if (space() < size + 2 + (dropped > 0 ? 2 : 0))
+    {
+        if (dropped < 0xFF)
+        {
+            dropped++;
+        }
+        return false;
+    }
+    if (dropped > 0)
+    {
+        put(TRACE_OVERFLOW);
+        put(dropped);
+        dropped = 0;
+    }
+    return true;
+}
+
+void InputTrace::frame(unsigned long dtMicros)
+{
+    if (!active || !reserve(1 + 5))
+    {
+        return;
+    }
+    put(TRACE_FRAME);
+    do
+    {
+        uint8_t data = dtMicros & 0x7F;
+        dtMicros >>= 7;
+        put(dtMicros != 0 ? data | 0x80 : data);
+    } while (dtMicros != 0);
+}
+
+void InputTrace::digital(uint8_t pin, uint8_t level)
+{
+    if (!active || pin >= TRACE_MAX_DIGITAL_PINS)
+    {
+        return;
+    }
+    uint16_t mask = 1U << pin;
+    bool high = level != 0;
+    if ((digitalKnown & mask) && ((digitalState & mask) != 0) == high)
+    {
+        return; // Unchanged
+    }
+    if (!reserve(1))
+    {
+        return; // Not marked as known, so it is retried on the next read
+    }
+    put((high ? TRACE_DIGITAL_HIGH : TRACE_DIGITAL_LOW) | pin);
+    digitalKnown |= mask;
+    if (high)
+        digitalState |= mask;
+    else
+        digitalState &= ~mask;
+}
+
+void InputTrace::analog(uint8_t channel, int value)
+{
+    if (!active || channel >= TRACE_MAX_ANALOG_CHANNELS || analogState[channel] == value || !reserve(3))
+    {
+        return;
+    }
+    put(TRACE_ANALOG | channel);
+    put(value & 0xFF);
+    put(value >> 8);
+    analogState[channel] = value;
+}
+
+uint8_t InputTrace::read(uint8_t *output, uint8_t maxLength)
+{
+    uint8_t count = 0;
+    while (count < maxLength && tail != head)
+    {
+        output[count++] = buffer[tail];
+        tail = (tail + 1) & (TRACE_BUFFER_SIZE - 1);
+    }
+    return count;
+}
+
+#endif // ENABLE_TRACE
@@ -1,44 +1,107 @@
 #include <Arduino.h>
-#include <stdio.h>
 #include "hardware/pwm.h"
 #include "hardware/led.h"
 #include "hardware/button.h"
 #include "hardware/pot.h"
 #include "hardware/display.h"
 #include "hardware/gate.h"
+#include "hardware/audio_voice.h"
+#include "hardware/cv_input.h"
+#include "hardware/envelope.h"
 #include "sequence.h"
+#include "edit_journal.h"
 #include "sequence_player.h"
+#include "step_events.h"
+#include "recorder.h"
+#include "arpeggiator.h"
+#include "serial_protocol.h"
+#include "pattern_store.h"
+#include "song.h"
+#include "ui_model.h"
+#include "profiler.h"
+#include "input_trace.h"
+#include "memory_stats.h"
+#include "sync_link.h"
+#include "format.h"
 
 const float MAX_VOLTAGE = 5.0; // Maximum output voltage for CV
 // Note that corresponds to 0V output in MIDI terms
 const int BASE_0V_NOTE = 36; // C2
+const int CV_SEMITONES = CvInput::SEMITONES; // Pitch CV range, MAX_VOLTAGE at 1V per octave
+
+// Pins and timers come from the board traits in include/hal, resolved at compile time
 
 // LEDs
-LED leftLED(12);
-LED rightLED(13);
+LED<Board::LEFT_LED_PIN> leftLED;
+LED<Board::RIGHT_LED_PIN> rightLED;
 
 // Buttons
-Button playButton(2);
-Button leftButton(7);
-Button rightButton(4);
+Button<Board::PLAY_BUTTON_PIN> playButton;
+Button<Board::LEFT_BUTTON_PIN> leftButton;
+Button<Board::RIGHT_BUTTON_PIN> rightButton;
 
-// Potentiometers - reduce smoothing to save memory
-Pot timingPot(3, 0.01f, 1);     // 10ms read interval, no smoothing to save memory
-Pot pitchPot(2, 0.01f, 1);      // 10ms read interval, no smoothing to save memory
-Pot modulationPot(1, 0.01f, 1); // 10ms read interval, no smoothing to save memory
+// Potentiometers with adaptive filtering, heavy smoothing at rest and low lag on fast turns
+Pot timingPot(Board::TIMING_POT_CHANNEL, 0.01f);         // 10ms read interval
+Pot pitchPot(Board::PITCH_POT_CHANNEL, 0.01f);           // 10ms read interval
+Pot modulationPot(Board::MODULATION_POT_CHANNEL, 0.01f); // 10ms read interval
 
 // CV output
-PWM cvOutPitch(9, MAX_VOLTAGE);
+PWM<Board::CvPwm> cvOutPitch(MAX_VOLTAGE);
 
 // CV Gate output
-Gate cvGate(8);
+Gate<Board::GATE_PIN> cvGate;
 
-// Create display object
+// Create display object and the precomputed screen contents
 Display oledDisplay;
+UiModel uiModel;
+static_assert(UiModel::NUM_ZOOM_LEVELS == PROTOCOL_ZOOM_LEVELS, "CMD_SET_VIEW zoom levels");
 
 // Sequence and player objects
-Sequence mainSequence(16);                    // 16-step sequence
-SequencePlayer player(&mainSequence, 120.0f); // Player with 120 BPM
+Sequence patternBufferA(16);                    // 16-step sequence
+Sequence patternBufferB(16);                    // Back buffer, filled while the other one plays
+SequencePlayer player(&patternBufferA, 120.0f); // Player with 120 BPM
+EditJournal editJournal;                        // Undo/redo for whichever buffer is edited
+Recorder recorder(&player);                     // Live recording into the sequence while playing
+Arpeggiator arpeggiator;                        // Replaces the step notes with held notes when on
+
+// Stored patterns and song chaining
+PatternStore patternStore(16);
+Song song(&patternStore, &player, &patternBufferA, &patternBufferB);
+
+// Pattern editing and telemetry over USB serial
+SerialProtocol serialLink(Serial, &player, &song);
+
+#ifdef ENABLE_SYNC
+#ifndef HAVE_HWSERIAL1
+#error "ENABLE_SYNC needs a second UART, use env:mega1284"
+#endif
+// Clock sync with other units on the second UART (see include/sync_link.h)
+SyncLink syncLink(Serial1, &player);
+#endif
+
+/**
+ * @brief Whether tempo and transport follow another unit over the sync link
+ */
+bool isSyncFollower()
+{
+#ifdef ENABLE_SYNC
+  return syncLink.getRole() == SYNC_FOLLOWER;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief The sequence that is playing and being edited
+ * @details Song mode swaps the pattern buffers at bar boundaries, and bulk
+ *          edits go live at the next step, so this is always taken from the
+ *          player instead of a fixed buffer. Until a bulk edit goes live it is
+ *          the edited copy.
+ */
+Sequence &activeSequence()
+{
+  return *player.getEditSequence();
+}
 
 // BPM display timing
 static float lastBpmChangeTime = 0.0f;
@@ -52,6 +115,12 @@ const float SCALE_DISPLAY_DURATION = 3.0f; // Show scale for 3 seconds after cha
 
 // Transpose tracking
 static int currentTranspose = 0; // Current transpose amount in semitones
+static int targetTranspose = 0;  // Transpose asked for, applied once Song has a buffer for the edit
+
+// Live recording
+static int recordNote = BASE_0V_NOTE; // Note written when recording, selected with the pitch pot
+static bool rightChordUsed = false;   // Right button was used in the play+right chord, ignore its release
+static bool leftChordUsed = false;    // Left button was used in the left+play undo chord, ignore its release
 
 /*
  * Available scales for randomization (selected by modulation pot):
@@ -67,190 +136,366 @@ static int currentTranspose = 0; // Current transpose amount in semitones
  * 9 = Blues scale
  */
 
-// Function declarations
-void scaleTypeToString(int scaleType, char *scaleStr);
-
 /**
- * @brief Convert MIDI note number to note name string (e.g., "C#3")
- * @param midiNote MIDI note number (0-127)
- * @param noteStr Output string buffer (must be at least 4 chars)
+ * @brief Convert MIDI note number to CV output voltage (1V per octave)
+ * @details Starting from MIDI note set in BASE_0V_NOTE, sets the PWM duty cycle
+ *          with integer math, clamped to the 0V to MAX_VOLTAGE range
+ * @param note MIDI note number to convert
  */
-void midiNoteToString(int midiNote, char *noteStr)
+void writeCVNote(int note)
 {
-  const char *noteNames[] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
-
-  int note = midiNote % 12;         // Get note within octave (0-11)
-  int octave = (midiNote / 12) - 1; // Calculate octave (-1 to 9 for MIDI range 0-127)
-
-  sprintf(noteStr, "%s%d", noteNames[note], octave);
+  int semitones = constrain(note - BASE_0V_NOTE, 0, CV_SEMITONES);
+  cvOutPitch.setRatio(semitones, CV_SEMITONES);
 }
 
 /**
- * @brief Convert MIDI note number to CV output voltage (1V per octave)
- * @details Starting from MIDI note set in BASE_0V_NOTE, calculates the appropriate
- *          voltage and sets the PWM duty cycle accordingly
+ * @brief Output a sequence note on the pitch CV
+ * @details Ignored while the CV input drives the pitch CV (see include/hardware/cv_input.h)
  * @param note MIDI note number to convert
- * @param channel PWM channel to output to (default: PWM_CHANNEL_9)
  */
 void setCVNote(int note)
 {
-  float voltage = (note - BASE_0V_NOTE) / 12.0;
-  float clampedVoltage = constrain(voltage, 0.0, MAX_VOLTAGE);
-  float dutyCycle = clampedVoltage / MAX_VOLTAGE; // Normalize to 0.0 - 1.0 range
-  cvOutPitch.setDutyCycle(dutyCycle);             // Set PWM duty cycle based on voltage
+  if (CvInput::getMode() == CV_IN_OFF)
+  {
+    writeCVNote(note);
+  }
 }
 
+/**
+ * @brief Recompute everything shown on screen into uiModel
+ * @details Runs once per frame, the page loop in UiModel::render() only rasterizes
+ */
+void updateUiModel()
+{
+  uiModel.header[0] = '\0';
+
+  // Show BPM only if it has changed in the last 3 seconds
+  if (totalTime - lastBpmChangeTime <= BPM_DISPLAY_DURATION)
+  {
+    char *end = formatString_P(uiModel.header, PSTR("BPM: "));
+    formatTenths(end, (unsigned int)(player.getBpm() * 10.0f + 0.5f));
+  }
+
+  // Show current scale type only if it has changed in the last 3 seconds
+  int currentScaleType = (int)modulationPot.getLinearValue(0, 9.99);
+
+  // Check if scale type has changed
+  if (currentScaleType != lastScaleType)
+  {
+    lastScaleType = currentScaleType;
+    lastScaleChangeTime = totalTime;
+  }
+
+  // Also don't show scale when bpm is shown, otherwise they overlap
+  if (totalTime - lastScaleChangeTime <= SCALE_DISPLAY_DURATION && totalTime - lastBpmChangeTime > BPM_DISPLAY_DURATION)
+  {
+    char *end = formatString_P(uiModel.header, PSTR("Scale: "));
+    formatScaleName(end, currentScaleType);
+  }
+
+  // Record indicator with the active record mode
+  uiModel.indicator[0] = '\0';
+  if (recorder.isArmed())
+  {
+    formatString_P(uiModel.indicator, recorder.getMode() == RECORD_REPLACE ? PSTR("RPL") : PSTR("OVR"));
+  }
+
+  // Sequence bars, current step indicator and current note
+  uiModel.setSteps(activeSequence(), player.getCurrentStep());
+  char *end = formatUInt(uiModel.stepLabel, player.getCurrentStep() + 1);
+  *end++ = '/';
+  formatUInt(end, activeSequence().getLength());
+  formatNoteName(uiModel.noteLabel, activeSequence().getNote(player.getCurrentStep()));
+}
+
+static bool uiRedrawPending = false; // Something changed since the frame being drawn was computed
+
+/**
+ * @brief Asks for the screen to be redrawn
+ * @details Only sets a flag, so it costs nothing at the call sites; serviceDisplay()
+ *          draws the frame from loop()
+ */
 void drawUI()
 {
-  // Early exit if display is not initialized
-  if (!oledDisplay.isInitialized())
+  uiRedrawPending = true;
+}
+
+/**
+ * @brief Draws the next page of the screen, one per loop() call
+ * @details The model is computed at the first page, so a frame never mixes two
+ *          states. A page is only drawn when the TWI queue has room for all of
+ *          it, so the display never makes loop() wait for the bus.
+ */
+void serviceDisplay()
+{
+  if (!oledDisplay.isInitialized() || !oledDisplay.canQueuePage())
     return;
 
-  auto &u8g2 = oledDisplay.getU8g2();
-  u8g2.firstPage(); // Start page mode rendering
-  do
+  bool startFrame = !oledDisplay.isFrameActive();
+  if (startFrame && !uiRedrawPending)
+    return;
+
+  PROFILE_SCOPE(PROFILE_DRAW_UI);
+  if (startFrame)
   {
-    // Draw BPM display only if it has changed in the last 3 seconds
-    if (totalTime - lastBpmChangeTime <= BPM_DISPLAY_DURATION)
-    {
-      char bpmStr[16];
-      char bpmValue[8];
-      dtostrf(player.getBpm(), 0, 1, bpmValue);
-      sprintf(bpmStr, "BPM: %s", bpmValue);
-      u8g2.drawStr(1, 8, bpmStr);
-    }
+    uiRedrawPending = false;
+    updateUiModel();
+    oledDisplay.beginFrame();
+  }
+  uiModel.renderPage(oledDisplay.getU8g2());
+  oledDisplay.queuePage();
+}
 
-    // Draw current scale type only if it has changed in the last 3 seconds
-    int currentScaleType = (int)modulationPot.getLinearValue(0, 9.99);
+/*
+ * Step event subscribers, dispatched at compile time by StepBus (see
+ * include/step_events.h). The realtime ones run at the step onset in this
+ * order, the UI redraw waits for the main loop.
+ */
 
-    // Check if scale type has changed
-    if (currentScaleType != lastScaleType)
-    {
-      lastScaleType = currentScaleType;
-      lastScaleChangeTime = totalTime;
-    }
+/**
+ * @brief Records the step onset for the jitter statistics, first so it sees the onset time
+ */
+struct StepOnsetProfile
+{
+  static const StepPriority PRIORITY = STEP_REALTIME;
+  static void onStep(const StepEvent &event)
+  {
+    (void)event; // Unused when the profiler is compiled out
+    PROFILE_STEP_ONSET((unsigned long)(event.noteDurationSeconds * 1000000.0f));
+  }
+};
 
-    // Also don't show scale when bpm is shown, otherwise they overlap
-    if (totalTime - lastScaleChangeTime <= SCALE_DISPLAY_DURATION && totalTime - lastBpmChangeTime > BPM_DISPLAY_DURATION)
+/**
+ * @brief Plays the step note, or the quantized CV input, on the CV output and the audio voice
+ */
+struct CvOutput
+{
+  static const StepPriority PRIORITY = STEP_REALTIME;
+  static void onStep(const StepEvent &event)
+  {
+    if (event.flags & STEP_EVENT_REST)
     {
-      char scaleStr[16];
-      char scaleDisplayStr[24];
-      scaleTypeToString(currentScaleType, scaleStr);
-      sprintf(scaleDisplayStr, "Scale: %s", scaleStr);
-      u8g2.drawStr(1, 8, scaleDisplayStr); // Position below BPM display
+      return;
     }
-
-    // Draw sequence visualization
-    const int SEQ_START_X = 0;
-    const int SEQ_START_Y = 10;                             // Move down to make room for scale display
-    const int SEQ_HEIGHT = 64 - 20;                        // Reduce height to accommodate scale text
-    const int STEP_WIDTH = 128 / mainSequence.getLength(); // Width of each step rectangle
-
-    int LOWEST_NOTE = 127;
-    int HIGHEST_NOTE = 0; // MIDI note range
-
-    // Set lowest and highest note to what is in the sequence
-    for (int i = 0; i < mainSequence.getLength(); i++)
+    int note = event.note;
+    CvInputMode cvInputMode = CvInput::getMode();
+    if (cvInputMode == CV_IN_TRIGGER)
     {
-      int note = mainSequence.getNote(i);
-      if (note < LOWEST_NOTE || LOWEST_NOTE == 127)
-        LOWEST_NOTE = note;
-      if (note > HIGHEST_NOTE || HIGHEST_NOTE == 0)
-        HIGHEST_NOTE = note;
+      return; // The trigger interrupt drives the pitch CV
     }
-    for (int i = 0; i < mainSequence.getLength(); i++)
+    if (cvInputMode == CV_IN_STEP)
     {
-      int x = SEQ_START_X + (i * STEP_WIDTH);
-      int note = mainSequence.getNote(i);
-      float gateDuration = mainSequence.getGateDuration(i);
+      note = BASE_0V_NOTE + CvInput::sampleSemitones();
+    }
+    writeCVNote(note);
+    VOICE_NOTE_ON(note); // Audio voice follows the CV when compiled in
+  }
+};
 
-      // Map note to height (higher notes = taller rectangles)
-      int noteHeight = map(note, LOWEST_NOTE, HIGHEST_NOTE, 3, SEQ_HEIGHT); // Map MIDI range to pixel height
-      int y = SEQ_START_Y + SEQ_HEIGHT - noteHeight;
+/**
+ * @brief Opens the gate for the step's gate duration
+ */
+struct GateOutput
+{
+  static const StepPriority PRIORITY = STEP_REALTIME;
+  static void onStep(const StepEvent &event)
+  {
+    if (event.flags & STEP_EVENT_REST)
+    {
+      return;
+    }
+    cvGate.trigger(event.noteDurationSeconds * event.gateDuration);
+  }
+};
 
-      // Calculate gate width based on gate duration (0.0 to 1.0)
-      int gateWidth = (int)(STEP_WIDTH * gateDuration);
-      if (gateWidth < 1)
-        gateWidth = 1; // Minimum 1 pixel width
+/**
+ * @brief Retriggers the envelope, its segment times follow the gate length
+ */
+struct EnvelopeOutput
+{
+  static const StepPriority PRIORITY = STEP_REALTIME;
+  static void onStep(const StepEvent &event)
+  {
+    if (event.flags & STEP_EVENT_REST)
+    {
+      return;
+    }
+    ENVELOPE_TRIGGER(event.noteDurationSeconds * event.gateDuration);
+  }
+};
 
-      // Draw rectangle - filled if current step, outline if not
-      if (i == player.getCurrentStep())
-      {
-        u8g2.drawBox(x, y, gateWidth, noteHeight); // Filled rectangle for current step
-      }
-      else
-      {
-        u8g2.drawFrame(x, y, gateWidth, noteHeight); // Outline rectangle for other steps
-      }
+/**
+ * @brief Beat LED on every step, loop LED on the first step
+ */
+struct ClockLeds
+{
+  static const StepPriority PRIORITY = STEP_REALTIME;
+  static void onStep(const StepEvent &event)
+  {
+    rightLED.blink(event.noteDurationSeconds / 2);
+    if (event.step == 0)
+    {
+      leftLED.blink(event.noteDurationSeconds);
     }
-    // Draw current step indicator
-    char stepStr[16];
-    sprintf(stepStr, "%d/%d", player.getCurrentStep() + 1, mainSequence.getLength());
-    u8g2.drawStr(128 - 24, 64, stepStr);
-    // Draw current note
-    char noteStr[16];
-    char noteName[8];
-    midiNoteToString(mainSequence.getNote(player.getCurrentStep()), noteName);
-    sprintf(noteStr, "%s", noteName);
-    u8g2.drawStr(0, 64, noteStr);
-
-  } while (u8g2.nextPage()); // End page mode rendering
-}
+  }
+};
 
 /**
- * @brief Callback function called when the sequencer advances to a new step
- * @param currentStep The current step index (0-based)
- * @param currentNote The MIDI note number for this step
- * @param noteDurationSeconds Duration of the note in seconds
+ * @brief Redraws the screen for the new step
  */
-void onSequencerStep(int currentStep, int currentNote, float noteDurationSeconds)
+struct UiRefresh
 {
-  // Play the current note
-  setCVNote(currentNote);
+  static const StepPriority PRIORITY = STEP_DEFERRED;
+  static void onStep(const StepEvent &)
+  {
+    drawUI();
+  }
+};
 
-  // Trigger CV gate output using the gate duration from the sequence
-  float gateDuration = mainSequence.getGateDuration(currentStep);
-  cvGate.trigger(noteDurationSeconds * gateDuration);
+typedef StepEventBus<StepOnsetProfile, CvOutput, GateOutput, EnvelopeOutput, ClockLeds, UiRefresh> StepBus;
 
-  // Calculate blink durations
-  float rightBlinkDuration = noteDurationSeconds / 2;
-  float leftBlinkDuration = noteDurationSeconds;
+/**
+ * @brief Called by the player when it advances to a new step
+ * @param event Step index, note and timing of the new step
+ */
+void publishStepEvent(const StepEvent &event)
+{
+  PROFILE_SCOPE(PROFILE_STEP_CALLBACK);
+  if (!arpeggiator.isActive())
+  {
+    StepBus::publish(event);
+    return;
+  }
 
-  // Turn on LED for beat indication
-  rightLED.blink(rightBlinkDuration);
+  // The step clocks the arpeggiator, steps with nothing held stay silent
+  StepEvent arpEvent = event;
+  int note = arpeggiator.nextNote();
+  if (note < 0)
+  {
+    arpEvent.flags |= STEP_EVENT_REST;
+  }
+  else
+  {
+    arpEvent.note = note;
+  }
+  StepBus::publish(arpEvent);
+}
+
+/*
+ * Staged boot: setup() only brings up the outputs and plays the first step,
+ * the slower startup work runs from loop(), one bounded stage per call, so
+ * playback timing never waits for it
+ */
+enum BootStage
+{
+  BOOT_DISPLAY_INIT, // Controller init, the screen stays dark
+  BOOT_FIRST_FRAME,  // Covers the whole screen, so no separate clear is needed, the screen goes on behind it
+  BOOT_DONE
+};
+static uint8_t bootStage = BOOT_DISPLAY_INIT;
 
-  if (currentStep == 0)
+/**
+ * @brief Runs the next startup stage that is ready
+ * @return true once startup is complete
+ */
+bool advanceBoot()
+{
+  switch (bootStage)
   {
-    leftLED.blink(leftBlinkDuration);
+  case BOOT_DISPLAY_INIT:
+    // The init sequence fits the empty TWI queue, frames then go out a page per loop()
+    oledDisplay.begin(400000);
+    break;
+  case BOOT_FIRST_FRAME:
+    drawUI();
+    oledDisplay.powerOn(); // Queued after the frame's last page
+    break;
+  default:
+    return true;
   }
-  drawUI(); // Draw the UI if needed
+  bootStage++;
+  return bootStage == BOOT_DONE;
 }
 
 void setup()
 {
+  // Outputs first, the last known pattern is on CV and gate before anything slow runs
   cvOutPitch.setup(20000); // Initialize PWM hardware with default 20kHz frequency
-
-  // Initialize display with slower I2C for more predictable timing
-  oledDisplay.setup(100000);                        // Use 100kHz instead of 400kHz for more consistent timing
-  oledDisplay.getU8g2().setFont(u8g2_font_6x10_tf); // Set default font
+  CvInput::begin();        // CV input quantizer, off until selected over the serial link
+  VOICE_BEGIN();           // Starts the Timer2 audio oscillator when ENABLE_AUDIO_VOICE is set
+  ENVELOPE_BEGIN();        // Envelope on the other Timer2 output when ENABLE_ENVELOPE is set
 
   // Initialize the sequence with a major scale manually
   int sequence[] = {36, 38, 40, 41, 43, 45, 47, 48}; // C2 major scale
   int sequenceLength = sizeof(sequence) / sizeof(int);
-  mainSequence.setNotes(sequence, sequenceLength);
-  // Set up the callback and start the player
-  player.onStepAdvance(onSequencerStep);
+  activeSequence().setNotes(sequence, sequenceLength);
+  // The last saved or cued pattern replaces it before the first step, one slot is a few dozen EEPROM reads
+  int lastSlot = patternStore.getLastSlot();
+  if (lastSlot >= 0)
+  {
+    patternStore.load(lastSlot, &activeSequence());
+  }
+  patternBufferA.setJournal(&editJournal); // After the initial pattern, which is not an edit
+  patternBufferB.setJournal(&editJournal);
+  // Start the player and play the first step now, later steps are reported through publishStepEvent()
   player.start();
+  player.retriggerStep();
+
+  Serial.begin(PROTOCOL_BAUD);
+  serialLink.setArpeggiator(&arpeggiator); // Mode and held notes come over the serial link
+#ifdef ENABLE_SYNC
+  Serial1.begin(SYNC_BAUD);
+  serialLink.setSyncLink(&syncLink); // Role is set over the serial link
+#endif
+  PROFILE_BEGIN(); // Calibrates the profiler when ENABLE_PROFILER is set
+  PROFILE_RESTART_CLOCK();
+  // The display comes up in advanceBoot(), called from loop()
+}
+
+/**
+ * @brief Clears a chord flag on the release that ends the chord
+ * @return true if the release belonged to a chord and should be ignored
+ */
+bool consumeChord(bool &chordUsed)
+{
+  bool used = chordUsed;
+  chordUsed = false;
+  return used;
+}
+
+/**
+ * @brief Transposes the pattern to targetTranspose as one bulk edit, waits while Song has no buffer for it
+ */
+void applyTranspose()
+{
+  if (targetTranspose == currentTranspose)
+  {
+    return;
+  }
+  Sequence *edited = song.beginEdit(); // Goes live at the next step as a whole
+  if (edited == nullptr)
+  {
+    return; // A song load or save holds the back buffer, retried on the next update()
+  }
+  edited->transpose(targetTranspose - currentTranspose);
+  song.commitEdit(edited);
+  currentTranspose = targetTranspose;
+
+  setCVNote(activeSequence().getNote(player.getCurrentStep())); // Update CV output to current note
+  drawUI();                                                     // Refresh display immediately
 }
 
-void update(float dt)
+void update(unsigned long dtMicros)
 {
+  // The player runs on the integer delta, seconds are only for the inputs and outputs below
+  float dt = dtMicros / 1000000.0f;
   // Update total time
   totalTime += dt;
   // Update inputs
   timingPot.update(dt);
   pitchPot.update(dt);
   modulationPot.update(dt); // Now update the modulation pot
+  CvInput::setScale((int)modulationPot.getLinearValue(0, 9.99)); // The CV input quantizes to the selected scale
   playButton.update(dt);
   leftButton.update(dt);
   rightButton.update(dt);
@@ -259,8 +504,8 @@ void update(float dt)
   if (player.getIsPlaying())
   {
     // Playing mode: Use timing pot for BPM control
-    float newBpm = timingPot.getLogValue(60.0, 500.0, 2.0);
-    if (timingPot.hasChanged(10)) // Only update if significant change
+    float newBpm = timingPot.getLogValue(60.0, 500.0);
+    if (timingPot.hasChanged(10) && !isSyncFollower()) // Only update if significant change, followers take the master's
     {
       player.setBpm(newBpm);
       lastBpmChangeTime = totalTime; // Record when BPM was changed
@@ -277,7 +522,7 @@ void update(float dt)
     int newNote = (int)pitchPot.getLinearValue(BASE_0V_NOTE, BASE_0V_NOTE + octaveRange);
     if (pitchPot.hasChanged(5)) // Only update if significant change
     {
-      mainSequence.setNote(player.getCurrentStep(), newNote);
+      activeSequence().setNote(player.getCurrentStep(), newNote);
       setCVNote(newNote); // Update CV output immediately
       drawUI();           // Refresh display immediately
     }
@@ -286,10 +531,19 @@ void update(float dt)
     float newGateDuration = timingPot.getLinearValue(0.1, 1.0); // 10% to 100%
     if (timingPot.hasChanged(10))                               // Only update if significant change
     {
-      mainSequence.setGateDuration(player.getCurrentStep(), newGateDuration);
+      activeSequence().setGateDuration(player.getCurrentStep(), newGateDuration);
       drawUI(); // Refresh display immediately
     }
   }
+  else if (recorder.isArmed())
+  {
+    // Record mode: Use pitch pot to select the note to record over the full CV range
+    int newNote = (int)pitchPot.getLinearValue(BASE_0V_NOTE, BASE_0V_NOTE + 60);
+    if (pitchPot.hasChanged(5))
+    {
+      recordNote = newNote;
+    }
+  }
   else
   {
     // Playing mode: Use pitch pot to transpose entire sequence
@@ -297,39 +551,58 @@ void update(float dt)
     int newTranspose = (int)pitchPot.getLinearValue(-12, 12);
     if (pitchPot.hasChanged(5)) // Only update if significant change
     {
-      int transposeChange = newTranspose - currentTranspose;
-      if (transposeChange != 0)
-      {
-        mainSequence.transpose(transposeChange);
-        currentTranspose = newTranspose;
-
-        setCVNote(mainSequence.getNote(player.getCurrentStep())); // Update CV output to current note
-
-        drawUI(); // Refresh display immediately
-      }
+      targetTranspose = newTranspose; // Applied by applyTranspose()
     }
   }
   // Check if the play button was pressed
   if (playButton.wasPressed())
   {
-    if (player.getIsPlaying())
+    if (leftButton.isPressed() || (!player.getIsPlaying() && rightButton.isPressed()))
     {
-      player.stop(); // Pause if currently playing
-      // Reset transpose when stopping
-      if (currentTranspose != 0)
+      // Left + play: undo the last edit, right + play while stopped: redo it
+      bool undo = leftButton.isPressed();
+      Sequence *edited = song.beginEdit();
+      bool changed = false;
+      if (edited != nullptr) // Ignored while a song load or save holds the back buffer
       {
-        mainSequence.transpose(-currentTranspose); // Undo current transpose
-        currentTranspose = 0;
-        drawUI(); // Refresh display
+        changed = undo ? edited->undo() : edited->redo();
+        song.commitEdit(edited);
       }
+      if (changed)
+      {
+        if (!player.getIsPlaying())
+        {
+          setCVNote(activeSequence().getNote(player.getCurrentStep()));
+        }
+        drawUI();
+      }
+      leftChordUsed = leftChordUsed || undo;
+      rightChordUsed = rightChordUsed || !undo;
+    }
+    else if (player.getIsPlaying() && rightButton.isPressed())
+    {
+      // Play + right: toggle live recording without stopping playback
+      if (recorder.isArmed())
+        recorder.disarm();
+      else
+        recorder.arm();
+      rightChordUsed = true;
+      drawUI();
+    }
+    else if (player.getIsPlaying())
+    {
+      player.stop(); // Pause if currently playing
+      recorder.disarm();
+      // Reset transpose when stopping, applyTranspose() takes it back
+      targetTranspose = 0;
     }
     else
     {
-      player.start(); // Resume/start if currently stopped
-      // Reset transpose when starting
-      currentTranspose = 0;
+      player.start(); // Resume/start if currently stopped, the transpose was reset by the stop
+      PROFILE_RESTART_CLOCK();
     }
   } // Button handling depends on play mode
+  applyTranspose();
   // Check for both buttons pressed simultaneously (randomize sequence) - highest priority
   static bool lastBothPressed = false;
   static bool justReleasedBoth = false;
@@ -339,14 +612,19 @@ void update(float dt)
     // Both buttons just pressed - randomize sequence
     // Use modulation pot to select scale type (0-9 scales)
     int scaleType = (int)modulationPot.getLinearValue(0, 9.99); // 0-9 scale types
-    mainSequence.randomize(BASE_0V_NOTE, 3, scaleType);         // Root=C2, 3 octaves, selected scale
-    setCVNote(mainSequence.getNote(player.getCurrentStep()));
+    Sequence *edited = song.beginEdit();
+    if (edited != nullptr) // Ignored while a song load or save holds the back buffer
+    {
+      edited->randomize(BASE_0V_NOTE, 3, scaleType); // Root=C2, 3 octaves, selected scale
+      song.commitEdit(edited);
+      setCVNote(activeSequence().getNote(player.getCurrentStep()));
 
-    // Update scale display timing to show the scale used for randomization
-    lastScaleType = scaleType;
-    lastScaleChangeTime = totalTime;
+      // Update scale display timing to show the scale used for randomization
+      lastScaleType = scaleType;
+      lastScaleChangeTime = totalTime;
 
-    drawUI();
+      drawUI();
+    }
   }
 
   // Track when both buttons were just released
@@ -368,46 +646,76 @@ void update(float dt)
     if (!player.getIsPlaying())
     {
       // Note edit mode: when paused, use left/right buttons to step through notes
-      if (leftButton.wasReleased())
+      if (leftButton.wasReleased() && !consumeChord(leftChordUsed))
       {
         // Move to previous step
         int currentStep = player.getCurrentStep();
-        int newStep = (currentStep - 1 + mainSequence.getLength()) % mainSequence.getLength();
+        int newStep = (currentStep - 1 + activeSequence().getLength()) % activeSequence().getLength();
         player.setCurrentStep(newStep);
 
         // Play the note and update CV output
-        setCVNote(mainSequence.getNote(newStep));
+        setCVNote(activeSequence().getNote(newStep));
         drawUI(); // Refresh display immediately
       }
 
-      if (rightButton.wasReleased())
+      if (rightButton.wasReleased() && !consumeChord(rightChordUsed))
       {
         // Move to next step
         int currentStep = player.getCurrentStep();
-        int newStep = (currentStep + 1) % mainSequence.getLength();
+        int newStep = (currentStep + 1) % activeSequence().getLength();
         player.setCurrentStep(newStep);
 
         // Play the note and update CV output
-        setCVNote(mainSequence.getNote(newStep));
+        setCVNote(activeSequence().getNote(newStep));
         drawUI(); // Refresh display immediately
       }
     }
+    else if (recorder.isArmed())
+    {
+      // Record mode: left button plays the selected note into the nearest step
+      static bool lastLeftPressed = false;
+      bool leftPressed = leftButton.isPressed();
+      if (leftPressed && !lastLeftPressed)
+      {
+        recorder.noteOn(recordNote);
+      }
+      else if (!leftPressed && lastLeftPressed)
+      {
+        recorder.noteOff(recordNote);
+        leftChordUsed = false;
+      }
+      lastLeftPressed = leftPressed;
+
+      // Right button switches between overdub and replace
+      if (rightButton.wasReleased())
+      {
+        if (rightChordUsed)
+        {
+          rightChordUsed = false;
+        }
+        else
+        {
+          recorder.setMode(recorder.getMode() == RECORD_OVERDUB ? RECORD_REPLACE : RECORD_OVERDUB);
+          drawUI();
+        }
+      }
+    }
     else
     {
       // Play mode: use left/right buttons to adjust sequence length
-      if (leftButton.wasReleased())
+      if (leftButton.wasReleased() && !consumeChord(leftChordUsed))
       {
         // Decrease sequence length (minimum 1 step)
-        int currentLength = mainSequence.getLength();
+        int currentLength = activeSequence().getLength();
         if (currentLength > 1)
         {
-          mainSequence.setLength(currentLength - 1);
+          activeSequence().setLength(currentLength - 1);
 
           // If current step is beyond new length, wrap to beginning
-          if (player.getCurrentStep() >= mainSequence.getLength())
+          if (player.getCurrentStep() >= activeSequence().getLength())
           {
             player.setCurrentStep(0);
-            setCVNote(mainSequence.getNote(0));
+            setCVNote(activeSequence().getNote(0));
           }
 
           drawUI(); // Refresh display immediately
@@ -417,54 +725,87 @@ void update(float dt)
       if (rightButton.wasReleased())
       {
         // Increase sequence length (up to maximum)
-        int currentLength = mainSequence.getLength();
-        if (currentLength < mainSequence.getMaxLength())
+        int currentLength = activeSequence().getLength();
+        if (rightChordUsed)
         {
-          mainSequence.setLength(currentLength + 1);
+          rightChordUsed = false; // Release after disarming recording, not a length change
+        }
+        else if (currentLength < activeSequence().getMaxLength())
+        {
+          activeSequence().setLength(currentLength + 1);
           drawUI(); // Refresh display immediately
         }
       }
     }
   }
 
+  // Write queued recorded notes before the player advances
+  if (recorder.process() > 0)
+  {
+    drawUI();
+  }
+
   // Update the player with the time delta
-  player.update(dt);
+  player.updateMicros(dtMicros);
   // Update outputs
   leftLED.update(dt);
   rightLED.update(dt);
   cvGate.update(dt);
-}
-
-/**
- * @brief Convert scale type number to scale name string
- * @param scaleType Scale type number (0-9)
- * @param scaleStr Output string buffer (must be at least 16 chars)
- */
-void scaleTypeToString(int scaleType, char *scaleStr)
-{
-  const char *scaleNames[] = {
-      "Major", "Minor", "Harm Min", "Lydian", "Mixolyd",
-      "Dorian", "Phrygian", "Pent Maj", "Pent Min", "Blues"};
-
-  if (scaleType >= 0 && scaleType <= 9)
-  {
-    strcpy(scaleStr, scaleNames[scaleType]);
-  }
-  else
-  {
-    strcpy(scaleStr, "Unknown");
-  }
+  VOICE_GATE(cvGate.getState()); // Silence the audio voice when the gate closes
 }
 
 void loop()
 {
-  // Calculate delta time in seconds
+  PROFILE_SCOPE(PROFILE_LOOP);
+
+  // Time since the last loop in microseconds
   static unsigned long lastFrameTime = 0;
   unsigned long currentTime = micros();
   unsigned long deltaTime = currentTime - lastFrameTime; // This handles overflow automatically
-  float dt = deltaTime / 1000000.0f;                     // Convert microseconds to seconds
   lastFrameTime = currentTime;
+  TRACE_FRAME_MICROS(deltaTime);
+  MEMORY_UPDATE();
 
   // Always prioritize timing-critical updates
-  update(dt);
-}
\ No newline at end of file
+  update(deltaTime);
+#ifdef ENABLE_SYNC
+  syncLink.poll(currentTime); // Right after the player update, both see the same time
+#endif
+
+  // Step consumers that don't need to run at the step onset (the display)
+  StepBus::runDeferred();
+
+  // Handle pattern edits and transport requests from the serial link, bounded per call
+  uint8_t serialChanges = serialLink.poll();
+
+  // Background pattern loads/saves and song chaining
+  Sequence *playingBefore = player.getSequence();
+  song.update();
+  if (player.getSequence() != playingBefore)
+  {
+    serialChanges |= PROTOCOL_CHANGED_PATTERN;
+  }
+  if (serialChanges & PROTOCOL_CHANGED_VIEW)
+  {
+    uiModel.setZoom(serialLink.getViewZoom());
+  }
+  if (serialChanges & PROTOCOL_CHANGED_TRANSPORT)
+  {
+    if (!player.getIsPlaying())
+    {
+      recorder.disarm();
+    }
+    PROFILE_RESTART_CLOCK();
+  }
+  if (serialChanges != 0)
+  {
+    setCVNote(activeSequence().getNote(player.getCurrentStep()));
+    drawUI();
+  }
+
+  // One page of the screen when one is due and fits the TWI queue
+  serviceDisplay();
+
+  // Display bring-up after power-on, nothing to do once it is done
+  advanceBoot();
+}
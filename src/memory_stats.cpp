@@ -0,0 +1,81 @@
+#include "memory_stats.h"
+
+#ifdef ENABLE_MEMORY_STATS
+
+#ifdef __AVR__
+
+#include <avr/io.h>
+
+extern char __data_start;
+extern char __heap_start;
+extern char *__brkval; // Heap break, 0 until the first malloc()
+
+// Runs from .init3, after the stack pointer is set and before .data/.bss are
+// initialised or any constructor runs, so nothing lives above the heap yet
+static void paintStack() __attribute__((naked, used, section(".init3")));
+static void paintStack()
+{
+    for (uint8_t *p = (uint8_t *)&__heap_start; p <= (uint8_t *)RAMEND; p++)
+    {
+        *p = MemoryStats::STACK_CANARY;
+    }
+}
+
+uint8_t *MemoryStats::heapPeakTop = (uint8_t *)&__heap_start;
+
+uint8_t *MemoryStats::heapTop()
+{
+    return __brkval ? (uint8_t *)__brkval : (uint8_t *)&__heap_start;
+}
+
+void MemoryStats::update()
+{
+    uint8_t *top = heapTop();
+    if (top > heapPeakTop)
+    {
+        heapPeakTop = top;
+    }
+}
+
+void MemoryStats::read(MemoryReport &report)
+{
+    update();
+    uint8_t *top = heapTop();
+    uint8_t *stackPointer = (uint8_t *)SP;
+
+    // Count the canaries left above the highest heap address ever used
+    uint8_t *p = heapPeakTop;
+    while (p < stackPointer && *p == STACK_CANARY)
+    {
+        p++;
+    }
+
+    report.staticBytes = (uint16_t)(&__heap_start - &__data_start);
+    report.heapBytes = (uint16_t)(top - (uint8_t *)&__heap_start);
+    report.heapPeak = (uint16_t)(heapPeakTop - (uint8_t *)&__heap_start);
+    report.stackPeak = (uint16_t)((uint8_t *)RAMEND - p + 1);
+    report.freeBytes = (uint16_t)(stackPointer - top);
+    report.minFreeBytes = (uint16_t)(p - heapPeakTop);
+}
+
+#else
+
+uint8_t *MemoryStats::heapPeakTop = nullptr;
+
+uint8_t *MemoryStats::heapTop()
+{
+    return nullptr;
+}
+
+void MemoryStats::update()
+{
+}
+
+void MemoryStats::read(MemoryReport &report)
+{
+    report = MemoryReport();
+}
+
+#endif // __AVR__
+
+#endif // ENABLE_MEMORY_STATS
@@ -0,0 +1,161 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include "pattern_store.h"
+
+// EEPROM addresses stay integers until the eeprom_* call, through uintptr_t so hosts with wider pointers build clean
+static inline uint8_t *eepromPointer(uint16_t address)
+{
+    return (uint8_t *)(uintptr_t)address;
+}
+
+static const uint16_t LAST_SLOT_ADDRESS = E2END; // Outside every slot, see getSlotCount()
+
+PatternStore::PatternStore(int maxPatternLength)
+    : maxSteps(maxPatternLength), slotSize(1 + maxPatternLength * 2), job(JOB_IDLE), jobSequence(nullptr),
+      jobJournal(nullptr), jobAddress(0), jobOffset(0), jobLength(0), lastSlot(0), lastSlotDirty(false)
+{
+}
+
+int PatternStore::getSlotCount()
+{
+    return LAST_SLOT_ADDRESS / slotSize;
+}
+
+bool PatternStore::isSlotUsed(int slot)
+{
+    if (slot < 0 || slot >= getSlotCount())
+    {
+        return false;
+    }
+    uint8_t length = eeprom_read_byte(eepromPointer(slot * slotSize));
+    return length > 0 && length <= maxSteps;
+}
+
+bool PatternStore::beginJob(Job newJob, int slot, Sequence *seq)
+{
+    if (job != JOB_IDLE || slot < 0 || slot >= getSlotCount() || seq == nullptr)
+    {
+        return false;
+    }
+    job = newJob;
+    jobSequence = seq;
+    jobAddress = slot * slotSize;
+    jobOffset = 0;
+    return true;
+}
+
+bool PatternStore::beginLoad(int slot, Sequence *target)
+{
+    if (!isSlotUsed(slot) || !beginJob(JOB_LOAD, slot, target))
+    {
+        return false;
+    }
+    jobJournal = target->getJournal();
+    target->setJournal(nullptr);
+    jobLength = eeprom_read_byte(eepromPointer(jobAddress));
+    jobSequence->setLength(jobLength);
+    return true;
+}
+
+bool PatternStore::beginSave(int slot, Sequence *source)
+{
+    if (!beginJob(JOB_SAVE, slot, source))
+    {
+        return false;
+    }
+    jobLength = source->getLength();
+    setLastSlot(slot);
+    return true;
+}
+
+int PatternStore::getLastSlot()
+{
+    int slot = lastSlotDirty ? lastSlot : eeprom_read_byte(eepromPointer(LAST_SLOT_ADDRESS));
+    return isSlotUsed(slot) ? slot : -1; // An erased byte reads 0xFF, past the last slot
+}
+
+void PatternStore::setLastSlot(int slot)
+{
+    if (slot >= 0 && slot < getSlotCount())
+    {
+        lastSlot = slot;
+        lastSlotDirty = true;
+    }
+}
+
+bool PatternStore::isBusy()
+{
+    return job != JOB_IDLE;
+}
+
+bool PatternStore::update()
+{
+    // Between jobs, and only when a write can start without waiting
+    if (job == JOB_IDLE && lastSlotDirty && eeprom_is_ready())
+    {
+        eeprom_update_byte(eepromPointer(LAST_SLOT_ADDRESS), lastSlot);
+        lastSlotDirty = false;
+    }
+
+    if (job == JOB_LOAD)
+    {
+        for (int i = 0; i < LOAD_STEPS_PER_UPDATE && jobOffset < jobLength; i++, jobOffset++)
+        {
+            uint16_t address = jobAddress + 1 + jobOffset * 2;
+            jobSequence->setNote(jobOffset, eeprom_read_byte(eepromPointer(address)));
+            jobSequence->setGateDuration(jobOffset, eeprom_read_byte(eepromPointer(address + 1)) / 255.0f);
+        }
+        if (jobOffset >= jobLength)
+        {
+            if (jobJournal != nullptr)
+            {
+                jobJournal->forget(jobSequence);
+                jobSequence->setJournal(jobJournal);
+                jobJournal = nullptr;
+            }
+            job = JOB_IDLE;
+            return true;
+        }
+    }
+    else if (job == JOB_SAVE)
+    {
+        // One byte per call and only when the previous write has completed. Steps come
+        // first and the length byte last, so an interrupted save leaves the old length.
+        if (!eeprom_is_ready())
+        {
+            return false;
+        }
+
+        int totalBytes = jobLength * 2;
+        if (jobOffset < totalBytes)
+        {
+            int step = jobOffset / 2;
+            uint8_t value;
+            if (jobOffset % 2 == 0)
+                value = jobSequence->getNote(step);
+            else
+                value = (uint8_t)(jobSequence->getGateDuration(step) * 255.0f + 0.5f);
+            eeprom_update_byte(eepromPointer(jobAddress + 1 + jobOffset), value);
+            jobOffset++;
+        }
+        else
+        {
+            eeprom_update_byte(eepromPointer(jobAddress), jobLength);
+            job = JOB_IDLE;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PatternStore::load(int slot, Sequence *target)
+{
+    if (!beginLoad(slot, target))
+    {
+        return false;
+    }
+    while (!update())
+    {
+    }
+    return true;
+}
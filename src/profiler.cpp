@@ -0,0 +1,162 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+ProfileStats Profiler::sections[PROFILE_NUM_SECTIONS];
+ProfileStats Profiler::stepJitter;
+long Profiler::minDrift = 0;
+long Profiler::maxDrift = 0;
+unsigned long Profiler::lastOnset = 0;
+unsigned long Profiler::idealOnset = 0;
+bool Profiler::clockRunning = false;
+unsigned int Profiler::overheadNanos = 0;
+
+void ProfileStats::reset()
+{
+    minValue = 0xFFFFFFFFUL;
+    maxValue = 0;
+    sum = 0;
+    count = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++)
+    {
+        histogram[i] = 0;
+    }
+}
+
+void ProfileStats::add(unsigned long value)
+{
+    if (value < minValue)
+        minValue = value;
+    if (value > maxValue)
+        maxValue = value;
+
+    // Halve both accumulators instead of overflowing, this keeps the mean intact
+    if (sum + value < sum)
+    {
+        sum >>= 1;
+        count >>= 1;
+    }
+    sum += value;
+    count++;
+
+    // Bucket index is the bit length of the value (0 -> 0, 1 -> 1, 2..3 -> 2, ...)
+    int bucket = 0;
+    while (value != 0 && bucket < NUM_BUCKETS - 1)
+    {
+        value >>= 1;
+        bucket++;
+    }
+    if (histogram[bucket] != 0xFFFF)
+    {
+        histogram[bucket]++;
+    }
+}
+
+void Profiler::begin()
+{
+    reset();
+
+    // Measure the cost of an empty scope timer so it can be subtracted by eye
+    const int CALIBRATION_RUNS = 256;
+    unsigned long start = micros();
+    for (int i = 0; i < CALIBRATION_RUNS; i++)
+    {
+        ProfileScope scope(PROFILE_LOOP);
+    }
+    unsigned long elapsed = micros() - start;
+    overheadNanos = (unsigned int)((elapsed * 1000UL) / CALIBRATION_RUNS);
+
+    reset(); // Drop the calibration samples
+}
+
+void Profiler::reset()
+{
+    for (int i = 0; i < PROFILE_NUM_SECTIONS; i++)
+    {
+        sections[i].reset();
+    }
+    stepJitter.reset();
+    minDrift = 0;
+    maxDrift = 0;
+    clockRunning = false;
+}
+
+void Profiler::record(ProfileSection section, unsigned long micros)
+{
+    sections[section].add(micros);
+}
+
+void Profiler::stepOnset(unsigned long periodMicros)
+{
+    unsigned long now = micros();
+
+    if (clockRunning)
+    {
+        // Interval error against the nominal step period
+        long intervalError = (long)(now - lastOnset) - (long)periodMicros;
+        stepJitter.add(intervalError < 0 ? -intervalError : intervalError);
+
+        // Accumulated drift against an ideal clock started at the first onset
+        idealOnset += periodMicros;
+        long drift = (long)(now - idealOnset);
+        if (drift < minDrift)
+            minDrift = drift;
+        if (drift > maxDrift)
+            maxDrift = drift;
+    }
+    else
+    {
+        idealOnset = now;
+        clockRunning = true;
+    }
+    lastOnset = now;
+}
+
+void Profiler::restartClock()
+{
+    clockRunning = false;
+}
+
+void Profiler::printStats(Print &out, const __FlashStringHelper *name, const ProfileStats &stats)
+{
+    out.print(name);
+    out.print(F(" n="));
+    out.print(stats.count);
+    if (stats.count > 0)
+    {
+        out.print(F(" min="));
+        out.print(stats.minValue);
+        out.print(F(" mean="));
+        out.print(stats.sum / stats.count);
+        out.print(F(" max="));
+        out.print(stats.maxValue);
+    }
+    out.print(F(" hist="));
+    for (int i = 0; i < ProfileStats::NUM_BUCKETS; i++)
+    {
+        out.print(stats.histogram[i]);
+        out.print(i < ProfileStats::NUM_BUCKETS - 1 ? ',' : '\n');
+    }
+}
+
+void Profiler::dump(Print &out)
+{
+    out.println(F("# profile (us), hist bucket i = [2^(i-1), 2^i)"));
+    out.print(F("# scope overhead ns="));
+    out.println(overheadNanos);
+
+    printStats(out, F("loop"), sections[PROFILE_LOOP]);
+    printStats(out, F("page"), sections[PROFILE_DRAW_UI]); // One display page per call
+    printStats(out, F("pot"), sections[PROFILE_POT_UPDATE]);
+    printStats(out, F("step"), sections[PROFILE_STEP_CALLBACK]);
+    printStats(out, F("jitter"), stepJitter);
+
+    out.print(F("drift min="));
+    out.print(minDrift);
+    out.print(F(" max="));
+    out.println(maxDrift);
+
+    reset(); // Each dump covers the time since the previous one
+}
+
+#endif // ENABLE_PROFILER
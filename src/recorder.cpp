@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include "recorder.h"
+
+Recorder::Recorder(SequencePlayer *seqPlayer)
+    : player(seqPlayer), queueHead(0), queueTail(0), armed(false), mode(RECORD_OVERDUB),
+      heldStep(-1), heldPosition(0)
+{
+}
+
+void Recorder::arm()
+{
+    armed = true;
+    heldStep = -1;
+}
+
+void Recorder::disarm()
+{
+    armed = false;
+    heldStep = -1;
+    queueTail = queueHead; // Drop anything not yet written
+}
+
+bool Recorder::isArmed()
+{
+    return armed;
+}
+
+void Recorder::setMode(RecordMode newMode)
+{
+    mode = newMode;
+}
+
+RecordMode Recorder::getMode()
+{
+    return mode;
+}
+
+bool Recorder::noteOn(int note)
+{
+    return enqueue(true, note);
+}
+
+bool Recorder::noteOff(int note)
+{
+    return enqueue(false, note);
+}
+
+bool Recorder::enqueue(bool isNoteOn, int note)
+{
+    if (!armed || !player->getIsPlaying())
+    {
+        return false;
+    }
+
+    uint8_t next = (queueHead + 1) & (QUEUE_SIZE - 1);
+    if (next == queueTail)
+    {
+        return false; // Queue full, drop the event rather than stall playback
+    }
+
+    RecordEvent &event = queue[queueHead];
+    event.isNoteOn = isNoteOn ? 1 : 0;
+    event.note = constrain(note, 0, 127);
+    event.step = player->getCurrentStep();
+    event.phase = player->getStepPhase(); // Exact position on the player's tick grid
+    queueHead = next;
+    return true;
+}
+
+int Recorder::process()
+{
+    int written = 0;
+    while (queueTail != queueHead)
+    {
+        const RecordEvent &event = queue[queueTail];
+        apply(event);
+        if (event.isNoteOn)
+        {
+            written++;
+        }
+        queueTail = (queueTail + 1) & (QUEUE_SIZE - 1);
+    }
+    return written;
+}
+
+void Recorder::apply(const RecordEvent &event)
+{
+    Sequence *sequence = player->getEditSequence();
+    int length = sequence->getLength();
+    if (length == 0)
+    {
+        return;
+    }
+
+    long position = (long)event.step * 256 + event.phase;
+
+    if (event.isNoteOn)
+    {
+        // Quantize to the nearest step: late in a step belongs to the next one
+        int step = event.step;
+        if (event.phase >= 128)
+        {
+            step = (step + 1) % length;
+        }
+
+        sequence->setNote(step, event.note);
+        heldStep = step;
+        heldPosition = position;
+    }
+    else if (heldStep >= 0)
+    {
+        if (mode == RECORD_REPLACE)
+        {
+            // Gate length is how long the note was held, wrapping around the end of the sequence
+            long span = position - heldPosition;
+            if (span < 0)
+            {
+                span += (long)length * 256;
+            }
+            float gateDuration = constrain(span / 256.0f, 0.1f, 1.0f);
+            sequence->setGateDuration(heldStep, gateDuration);
+        }
+        heldStep = -1;
+    }
+}
@@ -0,0 +1,56 @@
+#include "scales.h"
+
+static const uint16_t scaleMasks[NUM_SCALES] PROGMEM = {
+    0xAB5, // Major (Ionian)        0 2 4 5 7 9 11
+    0x6AD, // Natural minor         0 2 3 5 7 9 10
+    0x9AD, // Harmonic minor        0 2 3 5 7 8 11
+    0xAD5, // Lydian                0 2 4 6 7 9 11
+    0x6B5, // Mixolydian            0 2 4 5 7 9 10
+    0xAAD, // Dorian                0 2 3 5 7 9 11
+    0x56B, // Phrygian              0 1 3 5 6 8 10
+    0x295, // Pentatonic major      0 2 4 7 9
+    0x4A9, // Pentatonic minor      0 3 5 7 10
+    0x9B3, // Blues                 0 1 4 5 7 8 11
+};
+
+uint16_t getScaleMask(int scaleType)
+{
+    scaleType = constrain(scaleType, 0, NUM_SCALES - 1);
+    return pgm_read_word(&scaleMasks[scaleType]);
+}
+
+int quantizeToScale(int note, int rootNote, int scaleType)
+{
+    uint16_t mask = getScaleMask(scaleType);
+    // No division anywhere, this also runs from the CV input trigger interrupt. At most
+    // 11 steps over the MIDI range, and negative differences land in 0-11 as well
+    int pitchClass = note - rootNote;
+    while (pitchClass >= 12)
+    {
+        pitchClass -= 12;
+    }
+    while (pitchClass < 0)
+    {
+        pitchClass += 12;
+    }
+
+    // Every scale has a note within a tritone, look below first so ties go down
+    for (int distance = 0; distance <= 6; distance++)
+    {
+        int below = pitchClass - distance;
+        if (below < 0)
+            below += 12;
+        if (mask & (1 << below))
+        {
+            return note - distance;
+        }
+        int above = pitchClass + distance;
+        if (above >= 12)
+            above -= 12;
+        if (mask & (1 << above))
+        {
+            return note + distance;
+        }
+    }
+    return note;
+}
@@ -1,20 +1,23 @@
 #include <Arduino.h>
 #include "sequence.h"
+#include "scales.h"
 
 Sequence::Sequence(int maxSequenceLength)
-    : maxNotes(maxSequenceLength), currentNumNotes(0)
+    : maxNotes(maxSequenceLength < MAX_SEQUENCE_LENGTH ? maxSequenceLength : MAX_SEQUENCE_LENGTH), currentNumNotes(0), revision(0), lengthRevision(0), journal(nullptr)
 {
     // Allocate memory for the notes array
     notes = new int[maxNotes];
 
     // Allocate memory for the gate durations array
     gateDurations = new float[maxNotes];
+    stepRevisions = new uint16_t[maxNotes];
 
     // Initialize all notes to 0 and gate durations to 0.5 (50%)
     for (int i = 0; i < maxNotes; i++)
     {
         notes[i] = 0;
         gateDurations[i] = 0.5f; // Default 50% gate duration
+        stepRevisions[i] = 0;
     }
 }
 
@@ -31,18 +34,56 @@ Sequence::~Sequence()
         delete[] gateDurations;
         gateDurations = nullptr;
     }
+    if (stepRevisions != nullptr)
+    {
+        delete[] stepRevisions;
+        stepRevisions = nullptr;
+    }
+}
+
+void Sequence::beginEdit(uint16_t key)
+{
+    revision++;
+    if (journal != nullptr)
+    {
+        journal->beginEdit(this, key);
+    }
+}
+
+void Sequence::saveStep(int stepIndex)
+{
+    if (journal != nullptr)
+    {
+        journal->record(stepIndex, notes[stepIndex], gateDurations[stepIndex]);
+    }
+}
+
+void Sequence::setNumNotes(int length)
+{
+    if (length != currentNumNotes)
+    {
+        if (journal != nullptr)
+        {
+            journal->record(JOURNAL_LENGTH_STEP, currentNumNotes, 0.0f);
+        }
+        currentNumNotes = length;
+        lengthRevision = revision;
+    }
 }
 
 void Sequence::setNote(int stepIndex, int midiNote)
 {
-    if (stepIndex >= 0 && stepIndex < maxNotes)
+    if (stepIndex >= 0 && stepIndex < maxNotes && (notes[stepIndex] != midiNote || stepIndex >= currentNumNotes))
     {
+        beginEdit(EDIT_KEY_NOTE | stepIndex);
+        saveStep(stepIndex);
         notes[stepIndex] = midiNote;
+        touch(stepIndex);
 
         // Update current length if we're setting a note beyond current length
         if (stepIndex >= currentNumNotes)
         {
-            currentNumNotes = stepIndex + 1;
+            setNumNotes(stepIndex + 1);
         }
     }
 }
@@ -51,11 +92,17 @@ void Sequence::setNotes(int *midiNotes, int length)
 {
     if (length > 0 && length <= maxNotes)
     {
+        beginEdit();
         for (int i = 0; i < length; i++)
         {
-            notes[i] = midiNotes[i];
+            if (notes[i] != midiNotes[i])
+            {
+                saveStep(i);
+                notes[i] = midiNotes[i];
+                touch(i);
+            }
         }
-        currentNumNotes = length;
+        setNumNotes(length);
     }
 }
 
@@ -70,9 +117,10 @@ int Sequence::getNote(int stepIndex)
 
 void Sequence::setLength(int length)
 {
-    if (length >= 0 && length <= maxNotes)
+    if (length >= 0 && length <= maxNotes && length != currentNumNotes)
     {
-        currentNumNotes = length;
+        beginEdit();
+        setNumNotes(length);
     }
 }
 
@@ -88,12 +136,18 @@ int Sequence::getMaxLength()
 
 void Sequence::clear()
 {
+    beginEdit();
     for (int i = 0; i < maxNotes; i++)
     {
-        notes[i] = 0;
-        gateDurations[i] = 0.5f; // Reset to default 50% gate duration
+        if (notes[i] != 0 || gateDurations[i] != 0.5f)
+        {
+            saveStep(i);
+            notes[i] = 0;
+            gateDurations[i] = 0.5f; // Reset to default 50% gate duration
+            touch(i);
+        }
     }
-    currentNumNotes = 0;
+    setNumNotes(0);
 }
 
 void Sequence::transpose(int semitones)
@@ -132,38 +186,33 @@ void Sequence::transpose(int semitones)
     }
 
     // Apply the transposition
+    if (semitones == 0)
+        return;
+    beginEdit(EDIT_KEY_TRANSPOSE);
     for (int i = 0; i < currentNumNotes; i++)
     {
         if (notes[i] > 0) // Only transpose non-zero notes
         {
-            notes[i] += semitones;
+            int note = notes[i] + semitones;
             // Clamp to CV output range
-            if (notes[i] < CV_MIN_NOTE)
-                notes[i] = CV_MIN_NOTE;
-            else if (notes[i] > CV_MAX_NOTE)
-                notes[i] = CV_MAX_NOTE;
+            if (note < CV_MIN_NOTE)
+                note = CV_MIN_NOTE;
+            else if (note > CV_MAX_NOTE)
+                note = CV_MAX_NOTE;
+            if (note != notes[i])
+            {
+                saveStep(i);
+                notes[i] = note;
+                touch(i);
+            }
         }
     }
 }
 
 void Sequence::randomize(int rootNote, int octaves, int scaleType)
 {
-    // Define various scales/modes as intervals from root note
-    const int scalePatterns[][12] = {
-        {0, 2, 4, 5, 7, 9, 11, -1}, // Major scale (Ionian)
-        {0, 2, 3, 5, 7, 9, 10, -1}, // Natural minor (Aeolian)
-        {0, 2, 3, 5, 7, 8, 11, -1}, // Harmonic minor
-        {0, 2, 4, 6, 7, 9, 11, -1}, // Lydian
-        {0, 2, 4, 5, 7, 9, 10, -1}, // Mixolydian
-        {0, 2, 3, 5, 7, 9, 11, -1}, // Dorian
-        {0, 1, 3, 5, 6, 8, 10, -1}, // Phrygian
-        {0, 2, 4, 7, 9, -1},        // Pentatonic major
-        {0, 3, 5, 7, 10, -1},       // Pentatonic minor
-        {0, 1, 4, 5, 7, 8, 11, -1}, // Blues scale
-    };
-
-    const int numScales = 10;
-    scaleType = constrain(scaleType, 0, numScales - 1);
+    // Scale as a pitch class mask, see scales.h
+    uint16_t scaleMask = getScaleMask(scaleType);
 
     // Clamp parameters
     rootNote = constrain(rootNote, 0, 127);
@@ -177,10 +226,10 @@ void Sequence::randomize(int rootNote, int octaves, int scaleType)
     {
         for (int i = 0; i < 12; i++)
         {
-            if (scalePatterns[scaleType][i] == -1)
-                break; // End of scale pattern
+            if (!(scaleMask & (1 << i)))
+                continue; // Not in the scale
 
-            int note = rootNote + (octave * 12) + scalePatterns[scaleType][i];
+            int note = rootNote + (octave * 12) + i;
             if (note <= 127) // Stay within MIDI range
             {
                 notePool[notePoolSize++] = note;
@@ -189,8 +238,11 @@ void Sequence::randomize(int rootNote, int octaves, int scaleType)
     }
 
     // Randomize all notes in the current sequence length
+    beginEdit();
     for (int i = 0; i < currentNumNotes; i++)
     {
+        saveStep(i);
+        touch(i);
         if (notePoolSize > 0)
         {
             notes[i] = notePool[random(notePoolSize)];
@@ -205,12 +257,35 @@ void Sequence::randomize(int rootNote, int octaves, int scaleType)
     }
 }
 
+void Sequence::copyFrom(const Sequence &source)
+{
+    // Revisions are copied too, so change tracking carries on across the copy
+    int steps = maxNotes < source.maxNotes ? maxNotes : source.maxNotes;
+    for (int i = 0; i < steps; i++)
+    {
+        notes[i] = source.notes[i];
+        gateDurations[i] = source.gateDurations[i];
+        stepRevisions[i] = source.stepRevisions[i];
+    }
+    currentNumNotes = source.currentNumNotes < maxNotes ? source.currentNumNotes : maxNotes;
+    revision = source.revision;
+    lengthRevision = source.lengthRevision;
+    if (journal != nullptr && journal == source.journal)
+    {
+        journal->transfer(&source, this);
+    }
+}
+
 void Sequence::setGateDuration(int stepIndex, float duration)
 {
-    if (stepIndex >= 0 && stepIndex < maxNotes)
+    // Clamp duration to valid range (0.0 to 1.0)
+    duration = constrain(duration, 0.0f, 1.0f);
+    if (stepIndex >= 0 && stepIndex < maxNotes && gateDurations[stepIndex] != duration)
     {
-        // Clamp duration to valid range (0.0 to 1.0)
-        gateDurations[stepIndex] = constrain(duration, 0.0f, 1.0f);
+        beginEdit(EDIT_KEY_GATE | stepIndex);
+        saveStep(stepIndex);
+        gateDurations[stepIndex] = duration;
+        touch(stepIndex);
     }
 }
 
@@ -227,9 +302,102 @@ void Sequence::setGateDurations(float *durations, int length)
 {
     if (length > 0 && length <= maxNotes)
     {
+        beginEdit();
         for (int i = 0; i < length; i++)
         {
-            gateDurations[i] = constrain(durations[i], 0.0f, 1.0f);
+            float duration = constrain(durations[i], 0.0f, 1.0f);
+            if (gateDurations[i] != duration)
+            {
+                saveStep(i);
+                gateDurations[i] = duration;
+                touch(i);
+            }
+        }
+    }
+}
+
+uint16_t Sequence::getRevision()
+{
+    return revision;
+}
+
+bool Sequence::isStepChangedSince(int stepIndex, uint16_t sinceRevision)
+{
+    return stepIndex >= 0 && stepIndex < maxNotes && isNewer(stepRevisions[stepIndex], sinceRevision);
+}
+
+uint32_t Sequence::getChangedSteps(uint16_t sinceRevision, int firstStep)
+{
+    uint32_t changed = 0;
+    if (revision == sinceRevision)
+    {
+        return changed; // Nothing edited, skip the scan
+    }
+    for (int i = 0; i < 32 && firstStep + i < maxNotes; i++)
+    {
+        if (firstStep + i >= 0 && isNewer(stepRevisions[firstStep + i], sinceRevision))
+        {
+            changed |= 1UL << i;
         }
     }
+    return changed;
+}
+
+bool Sequence::isLengthChangedSince(uint16_t sinceRevision)
+{
+    return isNewer(lengthRevision, sinceRevision);
+}
+
+void Sequence::setJournal(EditJournal *editJournal)
+{
+    journal = editJournal;
+}
+
+EditJournal *Sequence::getJournal()
+{
+    return journal;
+}
+
+bool Sequence::undo()
+{
+    if (journal == nullptr || !journal->canUndo(this))
+    {
+        return false;
+    }
+    revision++;
+    journal->undo(this);
+    return true;
+}
+
+bool Sequence::redo()
+{
+    if (journal == nullptr || !journal->canRedo(this))
+    {
+        return false;
+    }
+    revision++;
+    journal->redo(this);
+    return true;
+}
+
+void Sequence::swapEntry(JournalEntry &entry)
+{
+    uint8_t step = entry.step;
+    if (step == JOURNAL_LENGTH_STEP)
+    {
+        // Not through setNumNotes(), which would journal the swap itself
+        uint8_t length = currentNumNotes;
+        currentNumNotes = entry.note;
+        lengthRevision = revision;
+        entry.note = length;
+        return;
+    }
+
+    uint8_t note = notes[step];
+    uint16_t gate = packGate(gateDurations[step]);
+    notes[step] = entry.note;
+    gateDurations[step] = unpackGate(entry.gate);
+    entry.note = note;
+    entry.gate = gate | (entry.gate & JOURNAL_GROUP_START); // The edit boundary stays with the entry
+    touch(step);
 }
@@ -1,25 +1,55 @@
+#include <Arduino.h>
 #include "sequence_player.h"
 
+// Step length in master ticks for each StepResolution, 0 = one bar
+static const uint8_t resolutionTicks[NUM_STEP_RESOLUTIONS] PROGMEM = {
+    12,  // 1/32
+    16,  // 1/16 triplet
+    24,  // 1/16
+    32,  // 1/8 triplet
+    48,  // 1/8
+    64,  // 1/4 triplet
+    96,  // 1/4
+    128, // 1/2 triplet
+    192, // 1/2
+    0,   // 1 bar, depends on the time signature
+};
+
 SequencePlayer::SequencePlayer(Sequence *seq, float initialBpm)
-    : sequence(seq), currentStepIndex(0), time(0.0f), isPlaying(false), bpm(initialBpm), stepCallback(nullptr)
+    : sequence(seq), queuedSequence(nullptr), stagedSequence(nullptr), editStaged(false), loopCount(0),
+      currentStepIndex(0), playPosition(0), isPlaying(false), bpm(initialBpm), masterTick(0), tickPeriod(0),
+      tickAccumulator(0), ticksIntoStep(0), stepTicks(PPQN), resolution(STEP_1_4), clockDivision(1),
+      clockMultiplication(1), beatsPerBar(4), beatUnit(4), direction(PLAY_FORWARD), stride(1), rotation(0)
 {
+    setBpm(initialBpm);
+    updateStepTicks();
 }
 
 void SequencePlayer::start()
 {
     isPlaying = true;
-    time = 0.0f;
+    tickAccumulator = 0;
+    ticksIntoStep = 0;
 }
 
 void SequencePlayer::stop()
 {
     isPlaying = false;
+    if (editStaged)
+    {
+        sequence = stagedSequence; // No step boundary is coming to take it
+        editStaged = false;
+        clampPosition();
+    }
 }
 
 void SequencePlayer::reset()
 {
-    currentStepIndex = 0;
-    time = 0.0f;
+    playPosition = 0;
+    currentStepIndex = sequence && direction != PLAY_RANDOM_WALK ? mapPosition(0, sequence->getLength()) : 0;
+    masterTick = 0;
+    tickAccumulator = 0;
+    ticksIntoStep = 0;
 }
 
 bool SequencePlayer::getIsPlaying()
@@ -37,37 +67,127 @@ void SequencePlayer::setCurrentStep(int step)
     if (sequence && step >= 0 && step < sequence->getLength())
     {
         currentStepIndex = step;
+
+        // Continue the playback order from the selected step
+        if (direction != PLAY_RANDOM_WALK)
+        {
+            int length = sequence->getLength();
+            int cycleLength = getCycleLength(length);
+            for (int position = 0; position < cycleLength; position++)
+            {
+                if (mapPosition(position, length) == step)
+                {
+                    playPosition = position;
+                    break;
+                }
+            }
+        }
     }
 }
 
 void SequencePlayer::update(float dt)
+{
+    updateMicros((unsigned long)(dt * 1000000.0f + 0.5f));
+}
+
+void SequencePlayer::updateMicros(unsigned long dtMicros)
 {
     if (!isPlaying || !sequence || sequence->getLength() == 0)
     {
         return;
     }
 
-    time += dt;
+    if (dtMicros > MAX_UPDATE_MICROS)
+    {
+        dtMicros = MAX_UPDATE_MICROS;
+    }
+    tickAccumulator += dtMicros << TICK_FRACTION_BITS;
 
-    if (time >= getNoteDurationSeconds())
+    // Whole ticks only, the remainder stays in the accumulator so the grid never drifts.
+    // After a stall only the newest step is published, the ones before it are passed
+    // over silently instead of firing CV and gate back to back.
+    bool stepDue = false;
+    while (tickAccumulator >= tickPeriod)
     {
-        // Advance to the next step
-        currentStepIndex = (currentStepIndex + 1) % sequence->getLength();
-        time = 0; // Reset accumulator for next note
+        tickAccumulator -= tickPeriod;
+        masterTick++;
+        if (++ticksIntoStep >= stepTicks)
+        {
+            ticksIntoStep = 0;
+            if (stepDue)
+            {
+                advancePosition();
+            }
+            stepDue = true;
+        }
+    }
+    if (stepDue)
+    {
+        advanceStep();
+    }
+}
 
-        // Call the callback if it's set
-        if (stepCallback)
+void SequencePlayer::advanceStep()
+{
+    advancePosition();
+    publishStep();
+}
+
+void SequencePlayer::advancePosition()
+{
+    if (editStaged)
+    {
+        // A shorter sequence restarts below through the cycle length check
+        sequence = stagedSequence;
+        editStaged = false;
+    }
+    playPosition++;
+    if (playPosition >= getCycleLength(sequence->getLength()))
+    {
+        // Bar boundary: swap in the queued sequence before its first step is reported
+        playPosition = 0;
+        loopCount++;
+        if (queuedSequence)
         {
-            stepCallback(currentStepIndex, getCurrentNote(), getNoteDurationSeconds());
+            sequence = queuedSequence;
+            queuedSequence = nullptr;
         }
     }
+    currentStepIndex = mapPosition(playPosition, sequence->getLength());
+}
+
+void SequencePlayer::retriggerStep()
+{
+    if (sequence && sequence->getLength() > 0)
+    {
+        publishStep();
+    }
+}
+
+void SequencePlayer::publishStep()
+{
+    StepEvent event;
+    event.step = currentStepIndex;
+    event.note = getCurrentNote();
+    event.flags = (playPosition == 0 ? STEP_EVENT_LOOP_START : 0) | (isBarStart() ? STEP_EVENT_BAR_START : 0);
+    event.gateDuration = sequence->getGateDuration(currentStepIndex);
+    event.noteDurationSeconds = getNoteDurationSeconds();
+    publishStepEvent(event);
+}
+
+// Used when the application does not define a bus, e.g. host tools that only drive the core
+void __attribute__((weak)) publishStepEvent(const StepEvent &)
+{
 }
 
 void SequencePlayer::setBpm(float newBpm)
 {
     if (newBpm > 0)
     {
-        bpm = newBpm;
+        bpm = constrain(newBpm, getMinBpm(), getMaxBpm());
+
+        // The only divide in the timing path, done once per tempo change
+        tickPeriod = (unsigned long)((60000000.0f * (1 << TICK_FRACTION_BITS)) / (bpm * PPQN) + 0.5f);
     }
 }
 
@@ -76,9 +196,235 @@ float SequencePlayer::getBpm()
     return bpm;
 }
 
+void SequencePlayer::setTickPeriod(unsigned long period)
+{
+    tickPeriod = constrain(period, MIN_TICK_MICROS << TICK_FRACTION_BITS, MAX_TICK_MICROS << TICK_FRACTION_BITS);
+    bpm = (60000000.0f * (1 << TICK_FRACTION_BITS)) / ((float)tickPeriod * PPQN);
+}
+
+unsigned long SequencePlayer::getTickPeriod()
+{
+    return tickPeriod;
+}
+
 float SequencePlayer::getNoteDurationSeconds()
 {
-    return 60.0f / bpm; // Duration of a quarter note in seconds
+    // Step length in ticks times the tick period, scaled from 1/256 microseconds to seconds
+    return stepTicks * (float)tickPeriod * (1.0f / (256.0f * 1000000.0f));
+}
+
+uint8_t SequencePlayer::getStepPhase()
+{
+    unsigned int tickFraction = tickAccumulator / ((tickPeriod >> 8) + 1); // 0-255 within the current tick
+    unsigned long phase = ((unsigned long)ticksIntoStep * 256 + tickFraction) / stepTicks;
+    return phase > 255 ? 255 : phase;
+}
+
+void SequencePlayer::setStepResolution(StepResolution newResolution)
+{
+    if (newResolution < NUM_STEP_RESOLUTIONS)
+    {
+        resolution = newResolution;
+        updateStepTicks();
+    }
+}
+
+StepResolution SequencePlayer::getStepResolution()
+{
+    return resolution;
+}
+
+void SequencePlayer::setClockRatio(uint8_t division, uint8_t multiplication)
+{
+    if (division > 0 && multiplication > 0)
+    {
+        clockDivision = division;
+        clockMultiplication = multiplication;
+        updateStepTicks();
+    }
+}
+
+void SequencePlayer::setTimeSignature(uint8_t beats, uint8_t unit)
+{
+    // Unit must be a power of two that divides a whole note into whole ticks
+    if (beats > 0 && beats <= 16 && unit > 0 && unit <= 32 && (unit & (unit - 1)) == 0)
+    {
+        beatsPerBar = beats;
+        beatUnit = unit;
+        updateStepTicks();
+    }
+}
+
+void SequencePlayer::updateStepTicks()
+{
+    unsigned long base = pgm_read_byte(&resolutionTicks[resolution]);
+    if (base == 0)
+    {
+        base = getTicksPerBar();
+    }
+
+    // Rounded to whole ticks, exact for ratios that divide the 96 PPQN grid
+    unsigned long ticks = (base * clockDivision + clockMultiplication / 2) / clockMultiplication;
+    stepTicks = ticks > 0 ? ticks : 1;
+    if (ticksIntoStep >= stepTicks)
+    {
+        ticksIntoStep = 0;
+    }
+}
+
+unsigned int SequencePlayer::getStepTicks()
+{
+    return stepTicks;
+}
+
+unsigned int SequencePlayer::getTicksPerBar()
+{
+    return beatsPerBar * (PPQN * 4 / beatUnit);
+}
+
+unsigned long SequencePlayer::getMasterTick()
+{
+    return masterTick;
+}
+
+bool SequencePlayer::isBarStart()
+{
+    return (masterTick - ticksIntoStep) % getTicksPerBar() == 0;
+}
+
+unsigned long SequencePlayer::getTickAccumulator()
+{
+    return tickAccumulator;
+}
+
+unsigned int SequencePlayer::getTicksIntoStep()
+{
+    return ticksIntoStep;
+}
+
+int SequencePlayer::getPlayPosition()
+{
+    return playPosition;
+}
+
+void SequencePlayer::setSyncPosition(unsigned long tick, unsigned int intoStep, int position, unsigned long accumulator)
+{
+    masterTick = tick;
+    ticksIntoStep = intoStep < stepTicks ? intoStep : 0;
+    tickAccumulator = accumulator;
+    if (sequence && sequence->getLength() > 0)
+    {
+        // Units with another length or direction keep their own order but stay on the same grid
+        playPosition = position % getCycleLength(sequence->getLength());
+        if (direction != PLAY_RANDOM_WALK)
+        {
+            currentStepIndex = mapPosition(playPosition, sequence->getLength());
+        }
+    }
+}
+
+int SequencePlayer::getCycleLength(int length)
+{
+    if (direction == PLAY_PENDULUM && length > 1)
+    {
+        return 2 * length - 2;
+    }
+    return length;
+}
+
+int SequencePlayer::mapPosition(int position, int length)
+{
+    if (length <= 0)
+    {
+        return 0;
+    }
+
+    int step;
+    switch (direction)
+    {
+    case PLAY_REVERSE:
+        step = length - 1 - position;
+        break;
+    case PLAY_PENDULUM:
+        step = position < length ? position : 2 * length - 2 - position;
+        break;
+    case PLAY_RANDOM_WALK:
+        // Relative to the step that is playing, rotation has no meaning here
+        return (currentStepIndex + length + (int)random(3) - 1) % length;
+    case PLAY_STRIDE:
+        step = (int)(((unsigned int)position * stride) % length);
+        break;
+    default:
+        step = position;
+        break;
+    }
+    return (step + rotation) % length;
+}
+
+void SequencePlayer::clampPosition()
+{
+    if (!sequence)
+    {
+        return;
+    }
+    int length = sequence->getLength();
+    if (playPosition >= getCycleLength(length))
+    {
+        playPosition = 0;
+    }
+    if (currentStepIndex >= length)
+    {
+        currentStepIndex = 0; // A random walk has no position to map from
+    }
+    remapStoppedStep();
+}
+
+void SequencePlayer::remapStoppedStep()
+{
+    if (!isPlaying && sequence && direction != PLAY_RANDOM_WALK)
+    {
+        currentStepIndex = mapPosition(playPosition, sequence->getLength());
+    }
+}
+
+void SequencePlayer::setDirection(PlaybackDirection newDirection)
+{
+    if (newDirection < NUM_PLAYBACK_DIRECTIONS)
+    {
+        // The position is kept, so playback continues in the new order without a jump in time
+        direction = newDirection;
+        clampPosition();
+    }
+}
+
+PlaybackDirection SequencePlayer::getDirection()
+{
+    return direction;
+}
+
+void SequencePlayer::setStride(uint8_t newStride)
+{
+    if (newStride > 0)
+    {
+        stride = newStride;
+        remapStoppedStep();
+    }
+}
+
+uint8_t SequencePlayer::getStride()
+{
+    return stride;
+}
+
+void SequencePlayer::setRotation(uint8_t steps)
+{
+    rotation = steps;
+    remapStoppedStep();
+}
+
+uint8_t SequencePlayer::getRotation()
+{
+    return rotation;
 }
 
 int SequencePlayer::getCurrentNote()
@@ -90,18 +436,60 @@ int SequencePlayer::getCurrentNote()
     return 0;
 }
 
-void SequencePlayer::onStepAdvance(StepCallback callback)
-{
-    stepCallback = callback;
-}
-
 void SequencePlayer::setSequence(Sequence *seq)
 {
     sequence = seq;
+    queuedSequence = nullptr;
+    editStaged = false;
     reset(); // Reset to beginning when setting new sequence
 }
 
+void SequencePlayer::queueSequence(Sequence *seq)
+{
+    queuedSequence = seq;
+}
+
 Sequence *SequencePlayer::getSequence()
 {
     return sequence;
 }
+
+Sequence *SequencePlayer::getQueuedSequence()
+{
+    return queuedSequence;
+}
+
+void SequencePlayer::stageSequence(Sequence *seq)
+{
+    if (!isPlaying)
+    {
+        sequence = seq; // No step is due, the stopped player only shows the new pattern
+        clampPosition();
+        return;
+    }
+    stagedSequence = seq;
+    editStaged = true;
+}
+
+bool SequencePlayer::withdrawStaged()
+{
+    // Once the flag is clear the step boundary can no longer swap, so the pointer compare is stable
+    bool wasStaged = editStaged;
+    editStaged = false;
+    return wasStaged && sequence != stagedSequence;
+}
+
+bool SequencePlayer::isEditStaged()
+{
+    return editStaged;
+}
+
+Sequence *SequencePlayer::getEditSequence()
+{
+    return editStaged ? stagedSequence : sequence;
+}
+
+unsigned int SequencePlayer::getLoopCount()
+{
+    return loopCount;
+}
@@ -0,0 +1,588 @@
+#include "serial_protocol.h"
+#include "arpeggiator.h"
+#include "profiler.h"
+#include "input_trace.h"
+#include "memory_stats.h"
+#include "sync_link.h"
+#include "hardware/audio_voice.h"
+#include "hardware/cv_input.h"
+#include "hardware/envelope.h"
+
+uint16_t crc16Update(uint16_t crc, uint8_t data)
+{
+    // CRC-16/CCITT-FALSE, polynomial 0x1021
+    crc ^= (uint16_t)data << 8;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        if (crc & 0x8000)
+            crc = (crc << 1) ^ 0x1021;
+        else
+            crc <<= 1;
+    }
+    return crc;
+}
+
+uint16_t crc16(const uint8_t *data, uint8_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < length; i++)
+    {
+        crc = crc16Update(crc, data[i]);
+    }
+    return crc;
+}
+
+uint8_t cobsEncode(const uint8_t *input, uint8_t length, uint8_t *output)
+{
+    uint8_t codeIndex = 0;
+    uint8_t outIndex = 1;
+    uint8_t code = 1;
+
+    for (uint8_t i = 0; i < length; i++)
+    {
+        if (input[i] == 0)
+        {
+            output[codeIndex] = code;
+            codeIndex = outIndex++;
+            code = 1;
+        }
+        else
+        {
+            output[outIndex++] = input[i];
+            code++;
+            if (code == 0xFF)
+            {
+                output[codeIndex] = code;
+                codeIndex = outIndex++;
+                code = 1;
+            }
+        }
+    }
+    output[codeIndex] = code;
+    output[outIndex++] = 0x00; // Frame delimiter
+    return outIndex;
+}
+
+CobsDecoder::CobsDecoder(uint8_t *frameBuffer, uint8_t bufferSize)
+    : buffer(frameBuffer), capacity(bufferSize)
+{
+    reset();
+}
+
+void CobsDecoder::reset()
+{
+    length = 0;
+    remaining = 0;
+    pendingZero = false;
+    overflow = false;
+}
+
+bool CobsDecoder::feed(uint8_t byte)
+{
+    if (byte == 0x00)
+    {
+        // Delimiter: the frame is only valid if the last block was complete
+        bool valid = !overflow && remaining == 0 && length > 0;
+        uint8_t frameLength = valid ? length : 0;
+        reset();
+        length = frameLength;
+        return true;
+    }
+
+    if (remaining == 0)
+    {
+        // Code byte starts a new block
+        if (pendingZero)
+        {
+            if (length < capacity)
+                buffer[length++] = 0x00;
+            else
+                overflow = true;
+        }
+        remaining = byte - 1;
+        pendingZero = byte != 0xFF;
+    }
+    else
+    {
+        if (length < capacity)
+            buffer[length++] = byte;
+        else
+            overflow = true;
+        remaining--;
+    }
+    return false;
+}
+
+SerialProtocol::SerialProtocol(Stream &port, SequencePlayer *seqPlayer, Song *patternSong)
+    : stream(port), player(seqPlayer), song(patternSong), syncLink(nullptr), arpeggiator(nullptr),
+      viewZoom(0), decoder(frame, sizeof(frame))
+{
+}
+
+void SerialProtocol::setSyncLink(SyncLink *link)
+{
+    syncLink = link;
+}
+
+void SerialProtocol::setArpeggiator(Arpeggiator *arp)
+{
+    arpeggiator = arp;
+}
+
+uint8_t SerialProtocol::poll()
+{
+    // Only start on a frame if its reply can be queued without blocking
+    if (stream.availableForWrite() < PROTOCOL_MAX_ENCODED)
+    {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < MAX_BYTES_PER_POLL && stream.available() > 0; i++)
+    {
+        if (decoder.feed(stream.read()))
+        {
+            uint8_t length = decoder.getLength();
+            decoder.reset();
+            if (length == 0)
+            {
+                continue; // Empty frame or line noise between frames
+            }
+            return handleFrame(length); // At most one frame per call
+        }
+    }
+
+#ifdef ENABLE_TRACE
+    // Stream the input trace when no reply was sent in this call
+    if (InputTrace::isActive())
+    {
+        uint8_t chunk[PROTOCOL_MAX_FRAME - 2];
+        chunk[0] = FRAME_TRACE;
+        uint8_t count = InputTrace::read(chunk + 1, sizeof(chunk) - 1);
+        if (count > 0)
+        {
+            sendFrame(chunk, 1 + count);
+        }
+    }
+#endif
+    return 0;
+}
+
+void SerialProtocol::sendFrame(const uint8_t *data, uint8_t length)
+{
+    uint8_t raw[PROTOCOL_MAX_FRAME];
+    uint8_t encoded[PROTOCOL_MAX_ENCODED];
+
+    memcpy(raw, data, length);
+    uint16_t crc = crc16(raw, length);
+    raw[length++] = crc >> 8;
+    raw[length++] = crc & 0xFF;
+
+    uint8_t encodedLength = cobsEncode(raw, length, encoded);
+    stream.write(encoded, encodedLength);
+}
+
+void SerialProtocol::sendReply(uint8_t command, uint8_t status, uint8_t payloadLength)
+{
+    reply[0] = command | RESPONSE_BIT;
+    reply[1] = status;
+    sendFrame(reply, 2 + payloadLength);
+}
+
+uint8_t SerialProtocol::handleFrame(uint8_t length)
+{
+    if (length < 3 || crc16(frame, length - 2) != (uint16_t)((frame[length - 2] << 8) | frame[length - 1]))
+    {
+        sendReply(FRAME_ERROR, STATUS_BAD_CRC, 0);
+        return 0;
+    }
+
+    uint8_t command = frame[0];
+    const uint8_t *args = frame + 1;
+    uint8_t argLength = length - 3;
+    uint8_t *payload = reply + 2;
+    Sequence *sequence = player->getEditSequence();
+    int sequenceLength = sequence->getLength();
+
+    switch (command)
+    {
+    case CMD_PING:
+        payload[0] = PROTOCOL_VERSION;
+        sendReply(command, STATUS_OK, 1);
+        return 0;
+
+    case CMD_GET_STEP:
+        if (argLength != 1 || args[0] >= sequenceLength)
+            break;
+        payload[0] = args[0];
+        payload[1] = sequence->getNote(args[0]);
+        payload[2] = (uint8_t)(sequence->getGateDuration(args[0]) * 255.0f + 0.5f);
+        sendReply(command, STATUS_OK, 3);
+        return 0;
+
+    case CMD_SET_STEP:
+        if (argLength != 3 || args[0] >= sequenceLength || args[1] > 127)
+            break;
+        sequence->setNote(args[0], args[1]);
+        sequence->setGateDuration(args[0], args[2] / 255.0f);
+        sendReply(command, STATUS_OK, 0);
+        return PROTOCOL_CHANGED_PATTERN;
+
+    case CMD_GET_PATTERN:
+    {
+        if (argLength != 2)
+            break;
+        uint8_t offset = args[0];
+        uint8_t count = args[1];
+        if (count > PROTOCOL_MAX_CHUNK_STEPS || offset + count > sequenceLength)
+            break;
+        payload[0] = sequenceLength;
+        payload[1] = offset;
+        payload[2] = count;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            payload[3 + i * 2] = sequence->getNote(offset + i);
+            payload[4 + i * 2] = (uint8_t)(sequence->getGateDuration(offset + i) * 255.0f + 0.5f);
+        }
+        sendReply(command, STATUS_OK, 3 + count * 2);
+        return 0;
+    }
+
+    case CMD_SET_PATTERN:
+    {
+        // Bulk upload arrives in chunks, each one is applied on its own so work per frame stays bounded
+        if (argLength < 3)
+            break;
+        uint8_t newLength = args[0];
+        uint8_t offset = args[1];
+        uint8_t count = args[2];
+        if (argLength != 3 + count * 2 || newLength == 0 || newLength > sequence->getMaxLength() ||
+            offset + count > newLength)
+            break;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (args[3 + i * 2] > 127)
+            {
+                sendReply(command, STATUS_BAD_ARGUMENT, 0);
+                return 0;
+            }
+        }
+        // The chunk goes live at the next step as a whole, the player restarts a step past the new end then
+        Sequence *edited = song->beginEdit();
+        if (edited == nullptr)
+        {
+            // No back buffer free (a song load or save is using it), the host retries the chunk
+            sendReply(command, STATUS_BUSY, 0);
+            return 0;
+        }
+        edited->setLength(newLength);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            edited->setNote(offset + i, args[3 + i * 2]);
+            edited->setGateDuration(offset + i, args[4 + i * 2] / 255.0f);
+        }
+        song->commitEdit(edited);
+        sendReply(command, STATUS_OK, 0);
+        return PROTOCOL_CHANGED_PATTERN;
+    }
+
+    case CMD_TRANSPORT:
+        if (argLength != 1)
+            break;
+        if (args[0] == TRANSPORT_STOP)
+            player->stop();
+        else if (args[0] == TRANSPORT_START)
+            player->start();
+        else if (args[0] == TRANSPORT_RESET)
+            player->reset();
+        else
+            break;
+        sendReply(command, STATUS_OK, 0);
+        return PROTOCOL_CHANGED_TRANSPORT;
+
+    case CMD_SET_BPM:
+    {
+        if (argLength != 2)
+            break;
+        unsigned int bpm10 = (args[0] << 8) | args[1];
+        if (bpm10 == 0)
+            break;
+        player->setBpm(bpm10 / 10.0f);
+        sendReply(command, STATUS_OK, 0);
+        return PROTOCOL_CHANGED_TRANSPORT;
+    }
+
+    case CMD_GET_TELEMETRY:
+    {
+        if (argLength != 0)
+            break;
+        unsigned int bpm10 = (unsigned int)(player->getBpm() * 10.0f + 0.5f);
+        payload[0] = (player->getIsPlaying() ? TELEMETRY_PLAYING : 0) | (song->isActive() ? TELEMETRY_SONG : 0);
+        payload[1] = player->getCurrentStep();
+        payload[2] = sequenceLength;
+        payload[3] = bpm10 >> 8;
+        payload[4] = bpm10 & 0xFF;
+        sendReply(command, STATUS_OK, 5);
+        return 0;
+    }
+
+    case CMD_GET_CHANGES:
+    {
+        // Patterns longer than 32 steps are asked for a page at a time
+        uint8_t firstStep = argLength == 3 ? args[2] : 0;
+        if ((argLength != 2 && argLength != 3) || firstStep >= sequence->getMaxLength())
+            break;
+        // Hosts keep the returned revision and fetch only the flagged steps next time
+        uint16_t revision = sequence->getRevision();
+        uint32_t changed = sequence->getChangedSteps((args[0] << 8) | args[1], firstStep);
+        payload[0] = revision >> 8;
+        payload[1] = revision & 0xFF;
+        payload[2] = sequenceLength;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            payload[3 + i] = (changed >> (24 - i * 8)) & 0xFF;
+        }
+        sendReply(command, STATUS_OK, 7);
+        return 0;
+    }
+
+    case CMD_GET_MEMORY:
+    {
+        if (argLength != 0)
+            break;
+#ifdef ENABLE_MEMORY_STATS
+        MemoryReport report;
+        MemoryStats::read(report);
+        const uint16_t values[] = {report.staticBytes, report.heapBytes, report.heapPeak,
+                                   report.stackPeak,   report.freeBytes, report.minFreeBytes};
+        for (uint8_t i = 0; i < 6; i++)
+        {
+            payload[i * 2] = values[i] >> 8;
+            payload[i * 2 + 1] = values[i] & 0xFF;
+        }
+        sendReply(command, STATUS_OK, 12);
+#else
+        sendReply(command, STATUS_UNSUPPORTED, 0);
+#endif
+        return 0;
+    }
+
+    case CMD_PROFILE:
+    {
+#ifdef ENABLE_PROFILER
+        // Diagnostic only: the dump is larger than the transmit buffer and blocks while it is sent
+        FramedTextWriter text(*this);
+        Profiler::dump(text);
+        text.flush();
+        sendReply(command, STATUS_OK, 0);
+#else
+        sendReply(command, STATUS_UNSUPPORTED, 0);
+#endif
+        return 0;
+    }
+
+    case CMD_TRACE:
+    {
+        if (argLength != 1 || args[0] > 1)
+            break;
+#ifdef ENABLE_TRACE
+        if (args[0] == 1)
+            InputTrace::start();
+        else
+            InputTrace::stop();
+        sendReply(command, STATUS_OK, 0);
+#else
+        sendReply(command, STATUS_UNSUPPORTED, 0);
+#endif
+        return 0;
+    }
+
+    case CMD_SET_VOICE:
+    {
+        if (argLength != 1 || args[0] >= NUM_WAVEFORMS)
+            break;
+#ifdef ENABLE_AUDIO_VOICE
+        AudioVoice::setWaveform((AudioWaveform)args[0]);
+        sendReply(command, STATUS_OK, 0);
+#else
+        sendReply(command, STATUS_UNSUPPORTED, 0);
+#endif
+        return 0;
+    }
+
+    case CMD_SET_ENVELOPE:
+    {
+        if (argLength != 5 || args[0] >= NUM_ENVELOPE_MODES)
+            break;
+#ifdef ENABLE_ENVELOPE
+        Envelope::setShape((EnvelopeMode)args[0], args[1], args[2], args[3], args[4]);
+        sendReply(command, STATUS_OK, 0);
+#else
+        sendReply(command, STATUS_UNSUPPORTED, 0);
+#endif
+        return 0;
+    }
+
+    case CMD_SYNC:
+    {
+        if (argLength > 1 || (argLength == 1 && args[0] >= NUM_SYNC_ROLES))
+            break;
+#ifdef ENABLE_SYNC
+        if (syncLink != nullptr)
+        {
+            if (argLength == 1)
+                syncLink->setRole((SyncRole)args[0]);
+            int16_t phase = constrain(syncLink->getPhaseError(), -32768L, 32767L);
+            unsigned int latency = syncLink->getLatency();
+            int16_t skew = constrain(syncLink->getSkewPpm(), -32768L, 32767L);
+            payload[0] = syncLink->getRole();
+            payload[1] = syncLink->isLocked() ? 1 : 0;
+            payload[2] = (uint16_t)phase >> 8;
+            payload[3] = (uint16_t)phase & 0xFF;
+            payload[4] = latency >> 8;
+            payload[5] = latency & 0xFF;
+            payload[6] = (uint16_t)skew >> 8;
+            payload[7] = (uint16_t)skew & 0xFF;
+            sendReply(command, STATUS_OK, 8);
+            return 0;
+        }
+#endif
+        sendReply(command, STATUS_UNSUPPORTED, 0);
+        return 0;
+    }
+
+    case CMD_SET_ARP:
+        if (argLength != 2 || args[0] >= NUM_ARP_MODES || args[1] < 1 || args[1] > Arpeggiator::MAX_OCTAVES)
+            break;
+        if (arpeggiator == nullptr)
+        {
+            sendReply(command, STATUS_UNSUPPORTED, 0);
+            return 0;
+        }
+        arpeggiator->setMode((ArpMode)args[0]);
+        arpeggiator->setOctaves(args[1]);
+        sendReply(command, STATUS_OK, 0);
+        return 0;
+
+    case CMD_ARP_NOTE:
+        if (argLength != 2 || args[1] > 1 || (args[0] > 127 && !(args[0] == 0xFF && args[1] == 0)))
+            break;
+        if (arpeggiator == nullptr)
+        {
+            sendReply(command, STATUS_UNSUPPORTED, 0);
+            return 0;
+        }
+        if (args[0] == 0xFF)
+            arpeggiator->releaseAll();
+        else if (args[1])
+            arpeggiator->noteOn(args[0]);
+        else
+            arpeggiator->noteOff(args[0]);
+        sendReply(command, STATUS_OK, 0);
+        return 0;
+
+    case CMD_SET_VIEW:
+        if (argLength != 1 || args[0] >= PROTOCOL_ZOOM_LEVELS)
+            break;
+        viewZoom = args[0];
+        sendReply(command, STATUS_OK, 0);
+        return PROTOCOL_CHANGED_VIEW;
+
+    case CMD_SET_CV_INPUT:
+        if (argLength != 1 || args[0] >= NUM_CV_INPUT_MODES)
+            break;
+        CvInput::setMode((CvInputMode)args[0]);
+        sendReply(command, STATUS_OK, 0);
+        return PROTOCOL_CHANGED_TRANSPORT;
+
+    case CMD_SAVE_PATTERN:
+        if (argLength != 1 || args[0] >= song->getStore()->getSlotCount())
+            break;
+        sendReply(command, song->getStore()->beginSave(args[0], sequence) ? STATUS_OK : STATUS_BUSY, 0);
+        return 0;
+
+    case CMD_CUE_PATTERN:
+        if (argLength != 1 || !song->getStore()->isSlotUsed(args[0]))
+            break;
+        sendReply(command, song->cuePattern(args[0]) ? STATUS_OK : STATUS_BUSY, 0);
+        return 0;
+
+    case CMD_SET_SONG:
+    {
+        if (argLength < 1 || argLength != 1 + args[0] * 2)
+            break;
+        song->clear();
+        for (uint8_t i = 0; i < args[0]; i++)
+        {
+            if (!song->addEntry(args[1 + i * 2], args[2 + i * 2]))
+            {
+                sendReply(command, STATUS_BAD_ARGUMENT, 0);
+                return 0;
+            }
+        }
+        sendReply(command, STATUS_OK, 0);
+        return 0;
+    }
+
+    case CMD_SONG:
+        if (argLength != 1 || args[0] > 1)
+            break;
+        if (args[0] == 0)
+            song->stop();
+        else if (!song->start())
+        {
+            sendReply(command, STATUS_BUSY, 0);
+            return 0;
+        }
+        sendReply(command, STATUS_OK, 0);
+        return 0;
+
+    case CMD_SET_CLOCK:
+        if (argLength != 5 || args[0] >= NUM_STEP_RESOLUTIONS || args[1] == 0 || args[2] == 0)
+            break;
+        player->setStepResolution((StepResolution)args[0]);
+        player->setClockRatio(args[1], args[2]);
+        player->setTimeSignature(args[3], args[4]);
+        sendReply(command, STATUS_OK, 0);
+        return PROTOCOL_CHANGED_TRANSPORT;
+
+    case CMD_SET_DIRECTION:
+        if (argLength != 3 || args[0] >= NUM_PLAYBACK_DIRECTIONS || args[1] == 0)
+            break;
+        player->setDirection((PlaybackDirection)args[0]);
+        player->setStride(args[1]);
+        player->setRotation(args[2]);
+        sendReply(command, STATUS_OK, 0);
+        return 0;
+
+    default:
+        sendReply(command, STATUS_UNKNOWN_COMMAND, 0);
+        return 0;
+    }
+
+    sendReply(command, STATUS_BAD_ARGUMENT, 0);
+    return 0;
+}
+
+FramedTextWriter::FramedTextWriter(SerialProtocol &target) : protocol(target), length(0)
+{
+    buffer[0] = FRAME_TEXT;
+}
+
+size_t FramedTextWriter::write(uint8_t c)
+{
+    buffer[1 + length++] = c;
+    if (length == TEXT_CHUNK || c == '\n')
+    {
+        flush();
+    }
+    return 1;
+}
+
+void FramedTextWriter::flush()
+{
+    if (length > 0)
+    {
+        protocol.sendFrame(buffer, 1 + length);
+        length = 0;
+    }
+}
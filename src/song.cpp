@@ -0,0 +1,217 @@
+#include "song.h"
+
+Song::Song(PatternStore *patternStore, SequencePlayer *seqPlayer, Sequence *bufferA, Sequence *bufferB)
+    : store(patternStore), player(seqPlayer), backIndex(1), numEntries(0), chaining(false), entryIndex(-1),
+      nextEntry(-1), repeatsLeft(0), lastLoopCount(0), pendingSlot(-1), loading(false), wanted(false),
+      backReady(false), staging(false)
+{
+    buffers[0] = bufferA;
+    buffers[1] = bufferB;
+}
+
+void Song::clear()
+{
+    stop();
+    numEntries = 0;
+}
+
+bool Song::addEntry(uint8_t pattern, uint8_t repeats)
+{
+    if (numEntries >= MAX_ENTRIES)
+    {
+        return false;
+    }
+    entries[numEntries].pattern = pattern;
+    entries[numEntries].repeats = repeats > 0 ? repeats : 1;
+    numEntries++;
+    return true;
+}
+
+int Song::getLength()
+{
+    return numEntries;
+}
+
+bool Song::start()
+{
+    if (numEntries == 0 || loading)
+    {
+        return false;
+    }
+    chaining = true;
+    entryIndex = -1;
+    nextEntry = 0;
+    repeatsLeft = 0;
+    lastLoopCount = player->getLoopCount();
+    preload(entries[0].pattern);
+    return true;
+}
+
+void Song::stop()
+{
+    chaining = false;
+    entryIndex = -1;
+    pendingSlot = -1;
+    wanted = false;
+    if (player->getQueuedSequence() == buffers[backIndex])
+    {
+        player->queueSequence(nullptr);
+    }
+    backReady = false;
+}
+
+bool Song::isActive()
+{
+    return chaining;
+}
+
+int Song::getCurrentEntry()
+{
+    return entryIndex;
+}
+
+bool Song::cuePattern(int slot)
+{
+    if (loading || !store->isSlotUsed(slot))
+    {
+        return false;
+    }
+    stop();
+    lastLoopCount = player->getLoopCount();
+    preload(slot);
+    store->setLastSlot(slot);
+    return true;
+}
+
+PatternStore *Song::getStore()
+{
+    return store;
+}
+
+void Song::preload(int slot)
+{
+    pendingSlot = slot;
+    wanted = true;
+    backReady = false;
+    tryPreload();
+}
+
+void Song::tryPreload()
+{
+    if (staging)
+    {
+        return; // Retried from update() once the edit is playing
+    }
+    if (!store->isSlotUsed(pendingSlot))
+    {
+        pendingSlot = -1; // Empty slot, keep playing what we have
+        return;
+    }
+
+    // Never fill the buffer that is playing
+    backIndex = player->getSequence() == buffers[0] ? 1 : 0;
+    if (store->beginLoad(pendingSlot, buffers[backIndex]))
+    {
+        loading = true;
+        pendingSlot = -1;
+    }
+}
+
+void Song::onWrap(bool swapped, unsigned int wraps)
+{
+    if (!chaining)
+    {
+        return;
+    }
+
+    if (swapped)
+    {
+        // The queued pattern goes in at the first wrap, the preloaded entry is now playing,
+        // start fetching the one after it
+        entryIndex = nextEntry;
+        repeatsLeft = entries[entryIndex].repeats;
+        nextEntry = (entryIndex + 1) % numEntries;
+        preload(entries[nextEntry].pattern);
+        wraps--;
+    }
+    if (repeatsLeft > 1)
+    {
+        // The last loop is kept, the next entry is queued from it
+        repeatsLeft = (unsigned int)repeatsLeft > wraps ? repeatsLeft - wraps : 1;
+    }
+}
+
+Sequence *Song::beginEdit()
+{
+    Sequence *playing = player->getSequence();
+    if (staging)
+    {
+        if (player->withdrawStaged())
+        {
+            return buffers[backIndex]; // Not live yet, keep editing the copy
+        }
+        staging = false;
+        playing = player->getSequence();
+        backIndex = playing == buffers[0] ? 1 : 0;
+    }
+    // The back buffer holds the next pattern, or a store job is reading the buffers
+    if (store->isBusy() || backReady || pendingSlot >= 0 || player->getQueuedSequence() != nullptr)
+    {
+        return nullptr;
+    }
+
+    backIndex = playing == buffers[0] ? 1 : 0;
+    buffers[backIndex]->copyFrom(*playing);
+    return buffers[backIndex];
+}
+
+void Song::commitEdit(Sequence *edited)
+{
+    if (edited != player->getSequence())
+    {
+        player->stageSequence(edited);
+        staging = true;
+    }
+}
+
+void Song::update()
+{
+    // The store runs one job at a time, so a finished job while loading is our load
+    bool jobFinished = store->update();
+    if (loading && jobFinished)
+    {
+        loading = false;
+        backReady = wanted;
+    }
+    else if (!loading && pendingSlot >= 0)
+    {
+        tryPreload(); // The store was busy with a save
+    }
+
+    // A staged edit went live, the other buffer is the back one now
+    if (staging && !player->isEditStaged())
+    {
+        staging = false;
+        backIndex = player->getSequence() == buffers[0] ? 1 : 0;
+    }
+
+    // Count bar boundaries from the player's loop counter, a stall may have crossed several
+    unsigned int wraps = player->getLoopCount() - lastLoopCount;
+    if (wraps > 0)
+    {
+        lastLoopCount += wraps;
+        bool swapped = player->getSequence() == buffers[backIndex];
+        if (swapped)
+        {
+            backIndex ^= 1;
+        }
+        onWrap(swapped, wraps);
+    }
+
+    // Queue the back buffer once it is loaded and the current entry is on its last loop
+    if (backReady && (!chaining || entryIndex < 0 || repeatsLeft <= 1))
+    {
+        player->queueSequence(buffers[backIndex]);
+        backReady = false;
+    }
+}
@@ -0,0 +1,273 @@
+#include "sync_link.h"
+
+static const unsigned int SYNC_BYTE_MICROS = (10 * 1000000UL + SYNC_BAUD / 2) / SYNC_BAUD; // 8N1
+static const long SYNC_MAX_TICK_DELTA = 64; // Keeps the error math within 32 bits
+
+SyncLink::SyncLink(Stream &port, SequencePlayer *seqPlayer)
+    : stream(port), player(seqPlayer), role(SYNC_OFF), decoder(frame, sizeof(frame)), lastPollMicros(0)
+{
+    setRole(SYNC_OFF);
+}
+
+void SyncLink::setRole(SyncRole newRole)
+{
+    if (newRole >= NUM_SYNC_ROLES)
+    {
+        return;
+    }
+    role = newRole;
+    decoder.reset();
+
+    sentFlags = UNKNOWN_FLAGS; // The first poll sends a clock frame
+    nextSyncTick = 0;
+    lastSendMicros = 0;
+
+    masterFlags = UNKNOWN_FLAGS; // The first clock frame sets the position
+    frequencyOffset = 0;
+    phaseError = 0;
+    lockCount = 0;
+    pingId = 0;
+    pingPending = false;
+    pingSentMicros = 0;
+    windowRoundTrip = 0xFFFFFFFFUL;
+    windowCount = 0;
+    linkDelay = 0;
+}
+
+SyncRole SyncLink::getRole()
+{
+    return role;
+}
+
+unsigned int SyncLink::wireMicros(uint8_t frameLength)
+{
+    return (frameLength + 2) * SYNC_BYTE_MICROS;
+}
+
+void SyncLink::poll(unsigned long nowMicros)
+{
+    // Frames read now arrived since the last poll, on average half a loop ago
+    unsigned long waitMicros = (nowMicros - lastPollMicros) / 2;
+    lastPollMicros = nowMicros;
+    if (role == SYNC_OFF)
+    {
+        return;
+    }
+
+    // Frames are short and cheap to handle, so every complete one is taken
+    for (uint8_t i = 0; i < MAX_BYTES_PER_POLL && stream.available() > 0; i++)
+    {
+        if (decoder.feed(stream.read()))
+        {
+            uint8_t length = decoder.getLength();
+            decoder.reset();
+            if (length >= 3 && crc16(frame, length - 2) == (uint16_t)((frame[length - 2] << 8) | frame[length - 1]))
+            {
+                handleFrame(length, nowMicros, waitMicros);
+            }
+        }
+    }
+
+    if (role == SYNC_MASTER)
+    {
+        sendClock(nowMicros);
+    }
+    else if (nowMicros - pingSentMicros >= SYNC_PING_MICROS && stream.availableForWrite() >= PING_FRAME + 2)
+    {
+        // An unanswered ping is simply replaced, one-way links never answer
+        uint8_t ping[PING_FRAME] = {SYNC_PING, ++pingId};
+        sendFrame(ping, 2);
+        pingPending = true;
+        pingSentMicros = nowMicros;
+    }
+}
+
+void SyncLink::sendFrame(uint8_t *data, uint8_t length)
+{
+    uint8_t encoded[CLOCK_FRAME + 2];
+    uint16_t crc = crc16(data, length);
+    data[length++] = crc >> 8;
+    data[length++] = crc & 0xFF;
+    stream.write(encoded, cobsEncode(data, length, encoded));
+}
+
+void SyncLink::handleFrame(uint8_t length, unsigned long nowMicros, unsigned long waitMicros)
+{
+    if (role == SYNC_MASTER && frame[0] == SYNC_PING && length == PING_FRAME)
+    {
+        uint8_t pong[PING_FRAME] = {SYNC_PONG, frame[1]};
+        sendFrame(pong, 2);
+    }
+    else if (role == SYNC_FOLLOWER && frame[0] == SYNC_CLOCK && length == CLOCK_FRAME)
+    {
+        handleClock(waitMicros);
+    }
+    else if (role == SYNC_FOLLOWER && frame[0] == SYNC_PONG && length == PING_FRAME && pingPending &&
+             frame[1] == pingId)
+    {
+        handlePong(nowMicros - waitMicros);
+    }
+}
+
+void SyncLink::sendClock(unsigned long nowMicros)
+{
+    bool playing = player->getIsPlaying();
+    uint8_t flags = playing ? SYNC_FLAG_PLAYING : 0;
+    unsigned long tick = player->getMasterTick();
+
+    bool due;
+    if (flags != sentFlags)
+    {
+        due = true;
+    }
+    else if (playing)
+    {
+        // Also catches a reset, which moves the tick back
+        due = (long)(tick - nextSyncTick) >= 0 || nextSyncTick - tick > SYNC_INTERVAL_TICKS;
+    }
+    else
+    {
+        due = nowMicros - lastSendMicros >= SYNC_KEEPALIVE_MICROS;
+    }
+    if (!due || stream.availableForWrite() < CLOCK_FRAME + 2)
+    {
+        return;
+    }
+
+    // The player was updated to nowMicros, so its state is the position right now
+    unsigned int tickMicros = player->getTickAccumulator() >> SequencePlayer::TICK_FRACTION_BITS;
+    unsigned long period = player->getTickPeriod();
+    unsigned int intoStep = player->getTicksIntoStep();
+    uint8_t clock[CLOCK_FRAME] = {
+        SYNC_CLOCK,
+        flags,
+        (uint8_t)(tick >> 24),
+        (uint8_t)(tick >> 16),
+        (uint8_t)(tick >> 8),
+        (uint8_t)tick,
+        (uint8_t)(tickMicros >> 8),
+        (uint8_t)tickMicros,
+        (uint8_t)(period >> 16),
+        (uint8_t)(period >> 8),
+        (uint8_t)period,
+        (uint8_t)(intoStep >> 8),
+        (uint8_t)intoStep,
+        (uint8_t)player->getPlayPosition(),
+    };
+    sendFrame(clock, CLOCK_FRAME - 2);
+
+    sentFlags = flags;
+    nextSyncTick = tick + SYNC_INTERVAL_TICKS;
+    lastSendMicros = nowMicros;
+}
+
+void SyncLink::handleClock(unsigned long waitMicros)
+{
+    uint8_t flags = frame[1];
+    unsigned long tick = ((unsigned long)frame[2] << 24) | ((unsigned long)frame[3] << 16) | ((unsigned int)frame[4] << 8) | frame[5];
+    unsigned long tickMicros = ((unsigned int)frame[6] << 8) | frame[7];
+    unsigned long period = ((unsigned long)frame[8] << 16) | ((unsigned int)frame[9] << 8) | frame[10];
+    unsigned int intoStep = ((unsigned int)frame[11] << 8) | frame[12];
+    int position = frame[13];
+    bool playing = flags & SYNC_FLAG_PLAYING;
+
+    // Where the master is now, in 1/256 microseconds past its sampled tick
+    unsigned long accumulator = (tickMicros + getLatency() + waitMicros) << SequencePlayer::TICK_FRACTION_BITS;
+
+    if (flags != masterFlags)
+    {
+        // Start, stop or the first frame: take over the master's position
+        masterFlags = flags;
+        if (playing)
+        {
+            player->start();
+        }
+        else
+        {
+            player->stop();
+        }
+        player->setTickPeriod(period + frequencyOffset);
+        player->setSyncPosition(tick, intoStep, position, playing ? accumulator : 0);
+        phaseError = 0;
+        lockCount = 0;
+        return;
+    }
+
+    // A local stop holds until the master's next transport change
+    if (!playing || !player->getIsPlaying())
+    {
+        return;
+    }
+
+    long tickDelta = (long)(player->getMasterTick() - tick);
+    long error = 0; // 1/256 microseconds
+    bool resync = tickDelta < -SYNC_MAX_TICK_DELTA || tickDelta > SYNC_MAX_TICK_DELTA;
+    if (!resync)
+    {
+        error = tickDelta * (long)period + (long)player->getTickAccumulator() - (long)accumulator;
+        resync = error / 256 < -SYNC_RESYNC_MICROS || error / 256 > SYNC_RESYNC_MICROS;
+    }
+    if (resync)
+    {
+        player->setTickPeriod(period + frequencyOffset);
+        player->setSyncPosition(tick, intoStep, position, accumulator);
+        phaseError = 0;
+        lockCount = 0;
+        return;
+    }
+
+    // PI loop, both terms spread over the ticks until the next clock frame
+    long limit = period >> 6;
+    frequencyOffset = constrain(frequencyOffset + error / (SYNC_INTERVAL_TICKS * 32), -limit, limit);
+    player->setTickPeriod(period + frequencyOffset + error / (SYNC_INTERVAL_TICKS * 4));
+
+    phaseError = error / 256;
+    if (phaseError < -SYNC_LOCK_MICROS || phaseError > SYNC_LOCK_MICROS)
+    {
+        lockCount = 0;
+    }
+    else if (lockCount < LOCK_FRAMES)
+    {
+        lockCount++;
+    }
+}
+
+void SyncLink::handlePong(unsigned long arrivalMicros)
+{
+    pingPending = false;
+    unsigned long roundTrip = arrivalMicros - pingSentMicros;
+    if (roundTrip < windowRoundTrip)
+    {
+        windowRoundTrip = roundTrip;
+    }
+
+    if (++windowCount >= PING_WINDOW)
+    {
+        // The fastest round trip had the least loop delay on both ends
+        unsigned long wire = 2 * wireMicros(PING_FRAME);
+        linkDelay = windowRoundTrip > wire ? (windowRoundTrip - wire) / 2 : 0;
+        windowRoundTrip = 0xFFFFFFFFUL;
+        windowCount = 0;
+    }
+}
+
+bool SyncLink::isLocked()
+{
+    return role == SYNC_FOLLOWER && lockCount >= LOCK_FRAMES;
+}
+
+long SyncLink::getPhaseError()
+{
+    return phaseError;
+}
+
+unsigned int SyncLink::getLatency()
+{
+    return wireMicros(CLOCK_FRAME) + linkDelay;
+}
+
+long SyncLink::getSkewPpm()
+{
+    unsigned long period = player->getTickPeriod();
+    return period > 0 ? (long)(frequencyOffset * 1000000.0f / period) : 0;
+}
@@ -0,0 +1,184 @@
+#include "ui_model.h"
+
+UiModel::UiModel()
+    : numColumns(0), columnWidth(0), stepsPerColumn(1), currentColumn(NO_COLUMN), stepsSource(nullptr),
+      stepsRevision(0), windowStart(0), windowSteps(0), zoom(0), lowestNote(0), highestNote(0)
+{
+    header[0] = '\0';
+    indicator[0] = '\0';
+    stepLabel[0] = '\0';
+    noteLabel[0] = '\0';
+}
+
+void UiModel::setZoom(uint8_t level)
+{
+    if (level < NUM_ZOOM_LEVELS)
+    {
+        zoom = level;
+    }
+}
+
+uint8_t UiModel::getZoom()
+{
+    return zoom;
+}
+
+void UiModel::setSteps(Sequence &sequence, int playingStep)
+{
+    int length = sequence.getLength();
+    uint16_t revision = sequence.getRevision();
+
+    // Window: the whole pattern if it fits the zoom level, else the page holding the playing step
+    int span = 16 << zoom;
+    int newWindowSteps = length <= span ? length : span;
+    int newWindowStart = length <= span ? 0 : playingStep / span * span;
+    bool sameLayout = &sequence == stepsSource && newWindowSteps == windowSteps && newWindowStart == windowStart &&
+                      !sequence.isLengthChangedSince(stepsRevision);
+
+    int inWindow = playingStep - newWindowStart;
+    if (sameLayout && revision == stepsRevision)
+    {
+        currentColumn = inWindow >= 0 && inWindow < windowSteps ? inWindow / stepsPerColumn : NO_COLUMN;
+        return; // Nothing edited since the last frame
+    }
+
+    // A new sequence, length or window changes every bar, otherwise only the columns of edited steps
+    uint32_t changed = 0xFFFFFFFFUL;
+    if (sameLayout)
+    {
+        changed = 0;
+        for (int chunk = 0; chunk < windowSteps; chunk += 32)
+        {
+            uint32_t steps = sequence.getChangedSteps(stepsRevision, windowStart + chunk);
+            for (uint8_t i = 0; steps != 0; i++, steps >>= 1)
+            {
+                if (steps & 1)
+                    changed |= 1UL << ((chunk + i) / stepsPerColumn);
+            }
+        }
+    }
+    stepsSource = &sequence;
+    stepsRevision = revision;
+    windowSteps = newWindowSteps;
+    windowStart = newWindowStart;
+
+    if (windowSteps == 0)
+    {
+        numColumns = 0;
+        currentColumn = NO_COLUMN;
+        return;
+    }
+    stepsPerColumn = (windowSteps + MAX_COLUMNS - 1) / MAX_COLUMNS;
+    columnWidth = 128 / ((windowSteps + stepsPerColumn - 1) / stepsPerColumn);
+    int windowEnd = windowStart + windowSteps < length ? windowStart + windowSteps : length; // The last page can be short
+    numColumns = (windowEnd - windowStart + stepsPerColumn - 1) / stepsPerColumn;
+    currentColumn = inWindow >= 0 && inWindow < windowSteps ? inWindow / stepsPerColumn : NO_COLUMN;
+
+    // Scale bar heights to the range of notes in the window
+    int lowest = 127;
+    int highest = 0;
+    for (int i = windowStart; i < windowEnd; i++)
+    {
+        int note = sequence.getNote(i);
+        if (note < lowest)
+            lowest = note;
+        if (note > highest)
+            highest = note;
+    }
+    if (lowest != lowestNote || highest != highestNote)
+    {
+        lowestNote = lowest;
+        highestNote = highest;
+        changed = 0xFFFFFFFFUL; // Every bar is scaled to the new range
+    }
+
+    for (uint8_t column = 0; column < numColumns; column++)
+    {
+        if (changed & (1UL << column))
+            setColumn(sequence, column, windowEnd);
+    }
+}
+
+uint8_t UiModel::noteTop(int note) const
+{
+    // Map note to height (higher notes = taller rectangles)
+    int noteHeight = SEQ_HEIGHT;
+    if (highestNote > lowestNote)
+    {
+        noteHeight = map(note, lowestNote, highestNote, MIN_BAR_HEIGHT, SEQ_HEIGHT);
+    }
+    return SEQ_BOTTOM - noteHeight;
+}
+
+void UiModel::setColumn(Sequence &sequence, uint8_t column, int windowEnd)
+{
+    int first = windowStart + column * stepsPerColumn;
+    if (stepsPerColumn == 1)
+    {
+        barTop[column] = noteTop(sequence.getNote(first));
+        barBottom[column] = SEQ_BOTTOM;
+
+        // Gate width follows the gate duration, at least 1 pixel
+        int gateWidth = (int)(columnWidth * sequence.getGateDuration(first));
+        barWidth[column] = gateWidth < 1 ? 1 : gateWidth;
+        return;
+    }
+
+    // Several steps share the column: draw the span from their highest to their lowest note
+    int last = first + stepsPerColumn < windowEnd ? first + stepsPerColumn : windowEnd;
+    int lowest = 127;
+    int highest = 0;
+    for (int i = first; i < last; i++)
+    {
+        int note = sequence.getNote(i);
+        if (note < lowest)
+            lowest = note;
+        if (note > highest)
+            highest = note;
+    }
+    barTop[column] = noteTop(highest);
+    int bottom = noteTop(lowest) + MIN_BAR_HEIGHT;
+    barBottom[column] = bottom < SEQ_BOTTOM ? bottom : SEQ_BOTTOM;
+    barWidth[column] = columnWidth > 1 ? columnWidth - 1 : 1; // Keeps neighbouring columns apart
+}
+
+// True if text drawn at this baseline touches the page band [bandTop, bandTop + 8)
+static bool textInBand(uint8_t baseline, uint8_t bandTop)
+{
+    return baseline > bandTop && baseline - UiModel::TEXT_HEIGHT < bandTop + 8;
+}
+
+void UiModel::renderPage(U8G2 &u8g2) const
+{
+    uint8_t bandTop = u8g2.getBufferCurrTileRow() * 8;
+    uint8_t bandBottom = bandTop + 8;
+
+    if (textInBand(HEADER_BASELINE, bandTop))
+    {
+        if (header[0] != '\0')
+            u8g2.drawStr(1, HEADER_BASELINE, header);
+        if (indicator[0] != '\0')
+            u8g2.drawStr(128 - 18, HEADER_BASELINE, indicator);
+    }
+
+    if (bandTop < SEQ_BOTTOM && bandBottom > SEQ_TOP)
+    {
+        for (uint8_t i = 0; i < numColumns; i++)
+        {
+            if (barTop[i] >= bandBottom || barBottom[i] <= bandTop)
+                continue;
+
+            // Filled rectangle for the current step, outline for the others
+            if (i == currentColumn)
+                u8g2.drawBox(i * columnWidth, barTop[i], barWidth[i], barBottom[i] - barTop[i]);
+            else
+                u8g2.drawFrame(i * columnWidth, barTop[i], barWidth[i], barBottom[i] - barTop[i]);
+        }
+    }
+
+    if (textInBand(FOOTER_BASELINE, bandTop))
+    {
+        u8g2.drawStr(128 - 24, FOOTER_BASELINE, stepLabel);
+        u8g2.drawStr(0, FOOTER_BASELINE, noteLabel);
+    }
+}
@@ -0,0 +1,312 @@
+/*
+ * bench_runner - runs the benchmark firmware under simavr and checks budgets
+ *
+ *   bench_runner <firmware.elf> <thresholds.txt> [--update]
+ *
+ * Counts the exact cycles between the markers written by src/bench, tracks
+ * the lowest stack pointer over the whole run and compares the mean cycles,
+ * the power-up time to the first gate edge, the stack depth and the free RAM
+ * against the thresholds file. Exits 1 when a pinned budget is exceeded.
+ * Budgets that have not been measured yet ("-" in the file) are reported
+ * but not checked, until --update pins them on a reference build.
+ * --update rewrites the thresholds from this run with 5% headroom instead of
+ * checking them.
+ *
+ * The SSD1306 is stubbed by an I2C sink that acknowledges every byte, so the
+ * TWI interrupt runs as it does with a display attached.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_twi.h>
+#include <simavr/avr_ioport.h>
+#include "../../src/bench/bench_markers.h"
+
+#define MCU_NAME "atmega328p"
+#define MCU_FREQUENCY 16000000UL
+#define RAM_START 0x100
+#define RAM_END 0x8FF
+#define MAX_CYCLES (MCU_FREQUENCY * 30) /* Give up after 30 simulated seconds */
+
+static const char *benchNames[BENCH_COUNT] = {
+    "overhead", "player_update", "player_step", "transpose", "randomize",
+    "set_cv_note", "pot_update", "draw_ui", "main_update"};
+
+struct BenchStats
+{
+    unsigned long count;
+    avr_cycle_count_t min;
+    avr_cycle_count_t max;
+    avr_cycle_count_t sum;
+};
+
+static struct BenchStats stats[BENCH_COUNT];
+static avr_cycle_count_t beginCycle;
+static int currentBench = -1;
+static int done = 0;
+static uint16_t heapStart;
+static avr_cycle_count_t bootCycles;
+static avr_cycle_count_t gateCycles; // First rising edge of the gate output, 0 until it rises
+
+static void onMarkerWrite(struct avr_t *avr, avr_io_addr_t addr, uint8_t value, void *param)
+{
+    (void)param;
+    avr->data[addr] = value;
+
+    if (value == BENCH_MARK_BEGIN)
+    {
+        currentBench = avr->data[BENCH_GPIOR1_ADDRESS];
+        beginCycle = avr->cycle;
+    }
+    else if (value == BENCH_MARK_END && currentBench >= 0 && currentBench < BENCH_COUNT)
+    {
+        avr_cycle_count_t cycles = avr->cycle - beginCycle;
+        struct BenchStats *s = &stats[currentBench];
+        if (s->count == 0 || cycles < s->min)
+            s->min = cycles;
+        if (cycles > s->max)
+            s->max = cycles;
+        s->sum += cycles;
+        s->count++;
+        currentBench = -1;
+    }
+    else if (value == BENCH_MARK_BOOT)
+    {
+        bootCycles = avr->cycle; // Counted from reset, reported next to the gate edge
+    }
+    else if (value == BENCH_MARK_DONE)
+    {
+        heapStart = avr->data[BENCH_GPIOR1_ADDRESS] | (avr->data[BENCH_GPIOR2_ADDRESS] << 8);
+        done = 1;
+    }
+}
+
+// Power-up ends when the gate pin goes high, whatever code path raised it
+static void onGatePin(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    avr_t *avr = (avr_t *)param;
+    if (value && gateCycles == 0)
+        gateCycles = avr->cycle;
+}
+
+static void attachGateProbe(avr_t *avr)
+{
+    avr_irq_t *pin = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(BENCH_GATE_PORT), BENCH_GATE_BIT);
+    avr_irq_register_notify(pin, onGatePin, avr);
+}
+
+// I2C sink standing in for the display: acknowledges the address and every data byte
+static avr_irq_t *sinkIrq;
+
+static void onTwiOutput(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+    avr_twi_msg_irq_t message;
+    message.u.v = value;
+    if (message.u.twi.msg & (TWI_COND_START | TWI_COND_WRITE))
+    {
+        avr_raise_irq(sinkIrq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, message.u.twi.addr, 1));
+    }
+}
+
+static void attachDisplaySink(avr_t *avr)
+{
+    static const char *names[2] = {"8>sink.out", "32<sink.in"};
+    sinkIrq = avr_alloc_irq(&avr->irq_pool, 0, 2, names);
+    avr_irq_register_notify(sinkIrq + TWI_IRQ_OUTPUT, onTwiOutput, NULL);
+    avr_connect_irq(sinkIrq + TWI_IRQ_INPUT, avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+    avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), sinkIrq + TWI_IRQ_OUTPUT);
+}
+
+#define LIMIT_NONE 0       /* No line for the name, nothing is checked */
+#define LIMIT_SET 1        /* A measured budget */
+#define LIMIT_UNMEASURED 2 /* "-", a budget that still has to come from --update, not checked */
+
+static int unpinned; // Checks skipped because their budget is still "-"
+
+// Thresholds file: one "<name> <limit>" per line, '#' starts a comment
+static int readLimit(const char *path, const char *name, unsigned long *limit)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return LIMIT_NONE;
+    char line[128];
+    char key[64];
+    char value[32];
+    int found = LIMIT_NONE;
+    while (found == LIMIT_NONE && fgets(line, sizeof(line), file) != NULL)
+    {
+        if (line[0] != '#' && sscanf(line, "%63s %31s", key, value) == 2 && strcmp(key, name) == 0)
+        {
+            char *end;
+            *limit = strtoul(value, &end, 10);
+            found = *end == '\0' && end != value ? LIMIT_SET : LIMIT_UNMEASURED;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+// Only measured budgets fail, an unmeasured one is counted so the report says the suite is not gating yet
+static int checkLimit(int hasLimit, int exceeded)
+{
+    unpinned += hasLimit == LIMIT_UNMEASURED;
+    return hasLimit == LIMIT_SET && exceeded;
+}
+
+// Budget column of the report
+static const char *limitText(int hasLimit, unsigned long limit, char *text, size_t size)
+{
+    if (hasLimit == LIMIT_SET)
+        snprintf(text, size, "%lu", limit);
+    else
+        snprintf(text, size, hasLimit == LIMIT_UNMEASURED ? "unset" : "-");
+    return text;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: bench_runner <firmware.elf> <thresholds.txt> [--update]\n");
+        return 2;
+    }
+    int update = argc > 3 && strcmp(argv[3], "--update") == 0;
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(argv[1], &firmware) != 0)
+    {
+        fprintf(stderr, "! cannot read %s\n", argv[1]);
+        return 2;
+    }
+
+    avr_t *avr = avr_make_mcu_by_name(MCU_NAME);
+    if (avr == NULL)
+    {
+        fprintf(stderr, "! simavr does not know %s\n", MCU_NAME);
+        return 2;
+    }
+    avr_init(avr);
+    avr->frequency = MCU_FREQUENCY;
+    avr_load_firmware(avr, &firmware);
+    avr->log = LOG_NONE;
+
+    avr_register_io_write(avr, BENCH_GPIOR0_ADDRESS, onMarkerWrite, NULL);
+    attachDisplaySink(avr);
+    attachGateProbe(avr);
+
+    // One instruction per avr_run() call, so the stack pointer is seen after every instruction
+    uint16_t minStackPointer = RAM_END;
+    int state = cpu_Running;
+    while (!done && state != cpu_Done && state != cpu_Crashed && avr->cycle < MAX_CYCLES)
+    {
+        state = avr_run(avr);
+        uint16_t stackPointer = avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+        if (stackPointer < minStackPointer)
+            minStackPointer = stackPointer;
+    }
+    if (!done)
+    {
+        fprintf(stderr, "! firmware did not finish (state %d, %llu cycles)\n", state,
+                (unsigned long long)avr->cycle);
+        return 2;
+    }
+
+    FILE *updated = NULL;
+    if (update)
+    {
+        updated = fopen(argv[2], "w");
+        if (updated == NULL)
+        {
+            fprintf(stderr, "! cannot write %s\n", argv[2]);
+            return 2;
+        }
+        fprintf(updated, "# Benchmark budgets checked by tools/bench/run.sh, mean cycles per call\n");
+        fprintf(updated, "# unless noted. Regenerate with `tools/bench/run.sh --update`.\n");
+        fprintf(updated, "# \"-\" marks a budget that has not been measured yet. It is reported but not\n");
+        fprintf(updated, "# checked until --update pins it to a simavr result plus 5%%. boot_us is a\n");
+        fprintf(updated, "# fixed requirement that --update keeps.\n");
+    }
+
+    avr_cycle_count_t overhead = stats[BENCH_OVERHEAD].count > 0 ? stats[BENCH_OVERHEAD].min : 0;
+    int failures = 0;
+
+    printf("%-14s %4s %9s %9s %9s %9s\n", "benchmark", "n", "min", "mean", "max", "limit");
+    for (int i = 1; i < BENCH_COUNT; i++)
+    {
+        struct BenchStats *s = &stats[i];
+        if (s->count == 0)
+        {
+            printf("%-14s    0  (not run)\n", benchNames[i]);
+            failures++;
+            continue;
+        }
+        unsigned long mean = (unsigned long)(s->sum / s->count - overhead);
+        unsigned long limit = 0;
+        int hasLimit = readLimit(argv[2], benchNames[i], &limit);
+        int failed = !update && checkLimit(hasLimit, mean > limit);
+        char text[16];
+        printf("%-14s %4lu %9llu %9lu %9llu %9s%s\n", benchNames[i], s->count,
+               (unsigned long long)(s->min - overhead), mean, (unsigned long long)(s->max - overhead),
+               limitText(hasLimit, limit, text, sizeof(text)), failed ? "  FAIL" : "");
+        failures += failed;
+        if (updated != NULL)
+            fprintf(updated, "%-16s %lu\n", benchNames[i], mean + mean / 20);
+    }
+
+    // A fixed requirement rather than a measured budget, --update keeps it. A gate that never rose fails
+    unsigned long bootMicros = (unsigned long)(gateCycles * 1000000ULL / MCU_FREQUENCY);
+    unsigned long bootLimit = 0;
+    int hasBootLimit = readLimit(argv[2], "boot_us", &bootLimit);
+    int bootFailed = gateCycles == 0 || (!update && checkLimit(hasBootLimit, bootMicros > bootLimit));
+    if (gateCycles == 0)
+        printf("power-up to first gate edge: the gate never rose  FAIL\n");
+    else
+        printf("power-up to first gate edge %llu cycles, %lu us%s\n", (unsigned long long)gateCycles, bootMicros,
+               bootFailed ? "  FAIL" : "");
+    printf("setup() returned after %llu cycles\n", (unsigned long long)bootCycles);
+    failures += bootFailed;
+    if (updated != NULL && hasBootLimit == LIMIT_SET)
+        fprintf(updated, "boot_us          %lu\n", bootLimit);
+
+    unsigned long stackBytes = RAM_END - minStackPointer;
+    unsigned long staticBytes = heapStart - RAM_START;
+    long freeBytes = (long)minStackPointer - (long)heapStart;
+    unsigned long stackLimit = 0;
+    unsigned long freeLimit = 0;
+    int hasStackLimit = readLimit(argv[2], "stack_bytes", &stackLimit);
+    int hasFreeLimit = readLimit(argv[2], "min_free_ram", &freeLimit);
+
+    printf("static RAM %lu bytes, stack high-water %lu bytes, lowest free RAM %ld bytes\n", staticBytes,
+           stackBytes, freeBytes);
+    char text[16];
+    if (!update && checkLimit(hasStackLimit, stackBytes > stackLimit))
+    {
+        printf("stack high-water above %s  FAIL\n", limitText(hasStackLimit, stackLimit, text, sizeof(text)));
+        failures++;
+    }
+    if (!update && checkLimit(hasFreeLimit, freeBytes < (long)freeLimit))
+    {
+        printf("free RAM below %s  FAIL\n", limitText(hasFreeLimit, freeLimit, text, sizeof(text)));
+        failures++;
+    }
+
+    if (updated != NULL)
+    {
+        fprintf(updated, "stack_bytes      %lu\n", stackBytes + stackBytes / 20);
+        fprintf(updated, "min_free_ram     %ld\n", freeBytes - freeBytes / 20);
+        fclose(updated);
+        printf("thresholds written to %s\n", argv[2]);
+        return 0;
+    }
+    if (unpinned > 0)
+        printf("%d budgets are not pinned yet and were not checked, run --update on a reference build\n", unpinned);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Build the benchmark firmware, run it under simavr and check it against
+# tools/bench/thresholds.txt. Needs PlatformIO and simavr (libsimavr, libelf).
+# Pass --update to rewrite the thresholds from the current results.
+set -e
+cd "$(dirname "$0")/../.."
+
+pio run -e bench
+mkdir -p .pio/bench
+cc -O2 -o .pio/bench/bench_runner tools/bench/bench_runner.c $(pkg-config --cflags --libs simavr 2>/dev/null || echo -lsimavr) -lelf
+.pio/bench/bench_runner .pio/build/bench/firmware.elf tools/bench/thresholds.txt "$@"
@@ -0,0 +1,75 @@
+"""
+ram_map - static RAM (.data + .bss) per subsystem
+
+Lists every RAM symbol of the firmware grouped by the source file it is
+defined in, largest first. The file comes from the debug info, so build with
+-g in build_flags for the full map; without it symbols are grouped by class
+and the remaining globals are listed together. Runs as a PlatformIO post
+script (see platformio.ini), which prints the largest groups and writes the
+full map to ram_map.txt next to firmware.elf, or directly:
+
+    python3 tools/ram_map.py .pio/build/uno/firmware.elf [avr-nm]
+"""
+
+import os
+import subprocess
+import sys
+from collections import defaultdict
+
+RAM_TYPES = "bBdD"
+
+
+def read_symbols(nm, elf):
+    output = subprocess.check_output([nm, "-C", "-l", "-S", "--size-sort", elf], universal_newlines=True)
+    for line in output.splitlines():
+        # <address> <size> <type> <name>[\t<file>:<line>]
+        fields = line.split(None, 3)
+        if len(fields) < 4 or fields[2] not in RAM_TYPES:
+            continue
+        name, _, location = fields[3].partition("\t")
+        yield int(fields[1], 16), name.strip(), location.strip()
+
+
+def subsystem(name, location):
+    if location:
+        return os.path.basename(location.rsplit(":", 1)[0])
+    if "::" in name:
+        return name.split("::", 1)[0]
+    return "(globals)"
+
+
+def ram_map(nm, elf):
+    # [(group size, group, [(size, name)...])...], largest group first
+    groups = defaultdict(list)
+    for size, name, location in read_symbols(nm, elf):
+        groups[subsystem(name, location)].append((size, name))
+    return sorted(((sum(size for size, _ in symbols), group, sorted(symbols, reverse=True))
+                   for group, symbols in groups.items()), key=lambda item: -item[0])
+
+
+def format_map(groups, detailed=True, limit=None):
+    lines = ["static RAM %d bytes" % sum(total for total, _, _ in groups)]
+    for total, group, symbols in groups[:limit]:
+        lines.append("%6d  %s" % (total, group))
+        if detailed:
+            lines.extend("%6d      %s" % (size, name) for size, name in symbols)
+    return "\n".join(lines) + "\n"
+
+
+def after_build(source, target, env):
+    elf = str(target[0])
+    nm = env.subst("$CC").replace("gcc", "nm")
+    groups = ram_map(nm, elf)
+    with open(os.path.join(os.path.dirname(elf), "ram_map.txt"), "w") as out:
+        out.write(format_map(groups))
+    sys.stdout.write(format_map(groups, detailed=False, limit=8))
+
+
+try:
+    Import("env")  # noqa: F821, defined when PlatformIO runs this as an extra script
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", after_build)  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        if len(sys.argv) < 2:
+            sys.exit("usage: ram_map.py <firmware.elf> [nm]")
+        sys.stdout.write(format_map(ram_map(sys.argv[2] if len(sys.argv) > 2 else "avr-nm", sys.argv[1])))